@@ -10,7 +10,7 @@ message("otter.pro is deprecated, use CMake instead.")
     error("Qt 5.2.0 or newer is required.")
 }
 
-QT += core gui multimedia network printsupport script sql webkitwidgets widgets
+QT += concurrent core gui multimedia network printsupport script sql webkitwidgets widgets
 
 win32: QT += winextras
 win32: LIBS += -lOle32 -lshell32 -ladvapi32 -luser32
@@ -41,6 +41,8 @@ SOURCES += src/main.cpp \
     src/core/BookmarksImporter.cpp \
     src/core/BookmarksManager.cpp \
     src/core/BookmarksModel.cpp \
+    src/core/ContentBlockingBenchmark.cpp \
+    src/core/ContentBlockingCompiledProfile.cpp \
     src/core/ContentBlockingManager.cpp \
     src/core/ContentBlockingProfile.cpp \
     src/core/Console.cpp \
@@ -49,12 +51,15 @@ SOURCES += src/main.cpp \
     src/core/FileSystemCompleterModel.cpp \
     src/core/GesturesManager.cpp \
     src/core/HistoryManager.cpp \
+    src/core/HistoryModel.cpp \
+    src/core/HistoryWorker.cpp \
     src/core/Importer.cpp \
     src/core/InputInterpreter.cpp \
     src/core/LocalListingNetworkReply.cpp \
     src/core/NetworkManager.cpp \
     src/core/NetworkManagerFactory.cpp \
     src/core/NetworkAutomaticProxy.cpp \
+    src/core/NetworkAutomaticProxyBenchmark.cpp \
     src/core/NetworkCache.cpp \
     src/core/NetworkProxyFactory.cpp \
     src/core/NotesManager.cpp \
@@ -70,6 +75,7 @@ SOURCES += src/main.cpp \
     src/core/TransfersManager.cpp \
     src/core/Utils.cpp \
     src/core/WebBackend.cpp \
+    src/core/WebsiteOptionsManager.cpp \
     src/core/WindowsManager.cpp \
     src/ui/AcceptCookieDialog.cpp \
     src/ui/AddressDelegate.cpp \
@@ -182,6 +188,8 @@ HEADERS += src/core/ActionsManager.h \
     src/core/BookmarksImporter.h \
     src/core/BookmarksManager.h \
     src/core/BookmarksModel.h \
+    src/core/ContentBlockingBenchmark.h \
+    src/core/ContentBlockingCompiledProfile.h \
     src/core/ContentBlockingManager.h \
     src/core/ContentBlockingProfile.h \
     src/core/Console.h \
@@ -190,10 +198,13 @@ HEADERS += src/core/ActionsManager.h \
     src/core/FileSystemCompleterModel.h \
     src/core/GesturesManager.h \
     src/core/HistoryManager.h \
+    src/core/HistoryModel.h \
+    src/core/HistoryWorker.h \
     src/core/Importer.h \
     src/core/InputInterpreter.h \
     src/core/LocalListingNetworkReply.h \
     src/core/NetworkAutomaticProxy.h \
+    src/core/NetworkAutomaticProxyBenchmark.h \
     src/core/NetworkCache.h \
     src/core/NetworkManager.h \
     src/core/NetworkManagerFactory.h \
@@ -211,6 +222,7 @@ HEADERS += src/core/ActionsManager.h \
     src/core/TransfersManager.h \
     src/core/Utils.h \
     src/core/WebBackend.h \
+    src/core/WebsiteOptionsManager.h \
     src/core/WindowsManager.h \
     src/ui/AcceptCookieDialog.h \
     src/ui/AddressDelegate.h \
@@ -0,0 +1,4 @@
+CREATE INDEX IF NOT EXISTS "visits_time" ON "visits" ("time");
+CREATE INDEX IF NOT EXISTS "visits_location" ON "visits" ("location");
+CREATE INDEX IF NOT EXISTS "visits_icon" ON "visits" ("icon");
+CREATE INDEX IF NOT EXISTS "visits_typed" ON "visits" ("typed", "time");
@@ -0,0 +1,5 @@
+CREATE VIRTUAL TABLE "locations_search" USING fts4("url", "title");
+INSERT INTO "locations_search" ("rowid", "url", "title") SELECT "locations"."id", ("locations"."scheme" || '://' || "hosts"."host" || "locations"."path"), (SELECT "visits"."title" FROM "visits" WHERE "visits"."location" = "locations"."id" ORDER BY "visits"."time" DESC LIMIT 1) FROM "locations" LEFT JOIN "hosts" ON "locations"."host" = "hosts"."id";
+CREATE TRIGGER "visits_search_insert" AFTER INSERT ON "visits" BEGIN INSERT OR REPLACE INTO "locations_search" ("rowid", "url", "title") SELECT "locations"."id", ("locations"."scheme" || '://' || "hosts"."host" || "locations"."path"), NEW."title" FROM "locations" LEFT JOIN "hosts" ON "locations"."host" = "hosts"."id" WHERE "locations"."id" = NEW."location"; END;
+CREATE TRIGGER "visits_search_update" AFTER UPDATE OF "location", "title" ON "visits" BEGIN INSERT OR REPLACE INTO "locations_search" ("rowid", "url", "title") SELECT "locations"."id", ("locations"."scheme" || '://' || "hosts"."host" || "locations"."path"), NEW."title" FROM "locations" LEFT JOIN "hosts" ON "locations"."host" = "hosts"."id" WHERE "locations"."id" = NEW."location"; END;
+CREATE TRIGGER "locations_search_delete" AFTER DELETE ON "locations" BEGIN DELETE FROM "locations_search" WHERE "rowid" = OLD."id"; END;
@@ -19,6 +19,7 @@
 
 #include "AddressCompletionModel.h"
 #include "BookmarksManager.h"
+#include "HistoryManager.h"
 #include "SettingsManager.h"
 
 #include <QtCore/QCoreApplication>
@@ -28,12 +29,16 @@ namespace Otter
 
 AddressCompletionModel* AddressCompletionModel::m_instance = NULL;
 
+const int AddressCompletionModel::m_historyLimit = 50;
+
 AddressCompletionModel::AddressCompletionModel(QObject *parent) : QAbstractListModel(parent),
+	m_historyRequest(0),
 	m_updateTimer(0)
 {
 	m_updateTimer = startTimer(250);
 
 	connect(BookmarksManager::getModel(), SIGNAL(modelModified()), this, SLOT(updateCompletion()));
+	connect(HistoryManager::getInstance(), SIGNAL(entriesReceived(quint64,QList<HistoryEntry>)), this, SLOT(entriesReceived(quint64,QList<HistoryEntry>)));
 	connect(SettingsManager::getInstance(), SIGNAL(valueChanged(QString,QVariant)), this, SLOT(optionChanged(QString)));
 }
 
@@ -73,6 +78,75 @@ void AddressCompletionModel::updateCompletion()
 	}
 }
 
+void AddressCompletionModel::entriesReceived(quint64 request, const QList<HistoryEntry> &entries)
+{
+	if (request == 0 || request != m_historyRequest)
+	{
+		return;
+	}
+
+	m_historyRequest = 0;
+
+	QStringList historyUrls;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		QString url = entries.at(i).url.toString();
+
+		if (!url.startsWith(m_filter, Qt::CaseInsensitive))
+		{
+			url = url.mid(url.indexOf(QLatin1String("://")) + 3);
+
+			if (!url.startsWith(m_filter, Qt::CaseInsensitive) && url.startsWith(QLatin1String("www.")))
+			{
+				url = url.mid(4);
+			}
+		}
+
+		if (url.startsWith(m_filter, Qt::CaseInsensitive) && !historyUrls.contains(url))
+		{
+			historyUrls.append(url);
+		}
+	}
+
+	setHistoryUrls(historyUrls);
+
+	emit completionUpdated(m_filter);
+}
+
+void AddressCompletionModel::setHistoryUrls(const QStringList &urls)
+{
+	if (urls != m_historyUrls)
+	{
+		beginResetModel();
+
+		m_historyUrls = urls;
+
+		endResetModel();
+	}
+}
+
+void AddressCompletionModel::setFilter(const QString &filter)
+{
+	if (filter == m_filter)
+	{
+		return;
+	}
+
+	m_filter = filter;
+
+	if (filter.length() > 1)
+	{
+		m_historyRequest = HistoryManager::requestFindEntries(filter, m_historyLimit);
+	}
+	else
+	{
+		m_historyRequest = 0;
+
+		setHistoryUrls(QStringList());
+	}
+}
+
 AddressCompletionModel* AddressCompletionModel::getInstance()
 {
 	if (!m_instance)
@@ -85,9 +159,17 @@ AddressCompletionModel* AddressCompletionModel::getInstance()
 
 QVariant AddressCompletionModel::data(const QModelIndex &index, int role) const
 {
-	if (role == Qt::DisplayRole && index.column() == 0 && index.row() >= 0 && index.row() < m_urls.count())
+	if (role == Qt::DisplayRole && index.column() == 0 && index.row() >= 0)
 	{
-		return m_urls.at(index.row());
+		if (index.row() < m_historyUrls.count())
+		{
+			return m_historyUrls.at(index.row());
+		}
+
+		if (index.row() < (m_historyUrls.count() + m_urls.count()))
+		{
+			return m_urls.at(index.row() - m_historyUrls.count());
+		}
 	}
 
 	return QVariant();
@@ -104,7 +186,7 @@ QVariant AddressCompletionModel::headerData(int section, Qt::Orientation orienta
 
 int AddressCompletionModel::rowCount(const QModelIndex &index) const
 {
-	return (index.isValid() ? 0 : m_urls.count());
+	return (index.isValid() ? 0 : (m_historyUrls.count() + m_urls.count()));
 }
 
 }
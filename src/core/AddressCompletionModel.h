@@ -20,7 +20,10 @@
 #ifndef OTTER_ADDRESSCOMPLETIONMODEL_H
 #define OTTER_ADDRESSCOMPLETIONMODEL_H
 
+#include "HistoryManager.h"
+
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QStringList>
 #include <QtCore/QUrl>
 
 namespace Otter
@@ -36,20 +39,32 @@ public:
 	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
 	int rowCount(const QModelIndex &index = QModelIndex()) const;
 
+public slots:
+	void setFilter(const QString &filter);
+
 protected:
 	explicit AddressCompletionModel(QObject *parent = NULL);
 
 	void timerEvent(QTimerEvent *event);
+	void setHistoryUrls(const QStringList &urls);
 
 protected slots:
 	void optionChanged(const QString &option);
 	void updateCompletion();
+	void entriesReceived(quint64 request, const QList<HistoryEntry> &entries);
 
 private:
 	QList<QUrl> m_urls;
+	QStringList m_historyUrls;
+	QString m_filter;
+	quint64 m_historyRequest;
 	int m_updateTimer;
 
 	static AddressCompletionModel *m_instance;
+	static const int m_historyLimit;
+
+signals:
+	void completionUpdated(const QString &filter);
 };
 
 }
@@ -34,6 +34,7 @@
 #include "ToolBarsManager.h"
 #include "Transfer.h"
 #include "TransfersManager.h"
+#include "WebsiteOptionsManager.h"
 #include "./config.h"
 #ifdef Q_OS_WIN
 #include "../modules/platforms/windows/WindowsPlatformIntegration.h"
@@ -198,12 +199,12 @@ Application::Application(int &argc, char **argv) : QApplication(argc, argv),
 
 	AddonsManager::createInstance(this);
 
+	HistoryManager::createInstance(this);
+
 	BookmarksManager::createInstance(this);
 
 	GesturesManager::createInstance(this);
 
-	HistoryManager::createInstance(this);
-
 	NetworkManagerFactory::createInstance(this);
 
 	NotesManager::createInstance(this);
@@ -216,6 +217,8 @@ Application::Application(int &argc, char **argv) : QApplication(argc, argv),
 
 	TransfersManager::createInstance(this);
 
+	WebsiteOptionsManager::createInstance(this);
+
 	setLocale(SettingsManager::getValue(QLatin1String("Browser/Locale")).toString());
 	setQuitOnLastWindowClosed(true);
 
@@ -228,6 +228,7 @@ BookmarksModel::BookmarksModel(const QString &path, FormatMode mode, QObject *pa
 	connect(this, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SIGNAL(modelModified()));
 	connect(this, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SIGNAL(modelModified()));
 	connect(this, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SIGNAL(modelModified()));
+	connect(HistoryManager::getInstance(), SIGNAL(iconLoaded(QUrl)), this, SLOT(updateIcon(QUrl)));
 }
 
 void BookmarksModel::trashBookmark(BookmarksItem *bookmark)
@@ -611,6 +612,18 @@ void BookmarksModel::writeBookmark(QXmlStreamWriter *writer, QStandardItem *book
 	}
 }
 
+void BookmarksModel::updateIcon(const QUrl &url)
+{
+	const QList<BookmarksItem*> bookmarks = getBookmarks(url);
+
+	for (int i = 0; i < bookmarks.count(); ++i)
+	{
+		const QModelIndex index = bookmarks.at(i)->index();
+
+		emit dataChanged(index, index);
+	}
+}
+
 void BookmarksModel::emptyTrash()
 {
 	BookmarksItem *trashItem = getTrashItem();
@@ -111,6 +111,9 @@ public:
 public slots:
 	void emptyTrash();
 
+protected slots:
+	void updateIcon(const QUrl &url);
+
 protected:
 	void readBookmark(QXmlStreamReader *reader, BookmarksItem *parent);
 	void writeBookmark(QXmlStreamWriter *writer, QStandardItem *bookmark) const;
@@ -0,0 +1,206 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "ContentBlockingBenchmark.h"
+#include "ContentBlockingCompiledProfile.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTextStream>
+#include <QtNetwork/QNetworkRequest>
+
+namespace Otter
+{
+
+int ContentBlockingBenchmark::run(const QStringList &arguments)
+{
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption(QLatin1String("content-blocking-benchmark"), QCoreApplication::translate("main", "Replays requests logged in <path> against content blocking profiles"), QLatin1String("path"), QString()));
+	parser.addOption(QCommandLineOption(QLatin1String("content-blocking-profile"), QCoreApplication::translate("main", "Uses content blocking profile from <path> instead of bundled ones, can be used multiple times"), QLatin1String("path"), QString()));
+	parser.process(arguments);
+
+	QTextStream output(stdout);
+	QTextStream errorOutput(stderr);
+	QFile file(parser.value(QLatin1String("content-blocking-benchmark")));
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		errorOutput << QStringLiteral("Failed to open requests log: %1\n").arg(file.errorString());
+
+		return 1;
+	}
+
+	QStringList paths = parser.values(QLatin1String("content-blocking-profile"));
+
+	if (paths.isEmpty())
+	{
+		const QList<QFileInfo> bundledProfiles = QDir(QLatin1String(":/blocking/")).entryInfoList(QStringList(QLatin1String("*.txt")), QDir::Files);
+
+		for (int i = 0; i < bundledProfiles.count(); ++i)
+		{
+			paths.append(bundledProfiles.at(i).filePath());
+		}
+	}
+
+// compiled profiles are saved next to lists, so even bundled ones need to be copied to writable location
+	QTemporaryDir temporaryDirectory;
+
+	if (!temporaryDirectory.isValid())
+	{
+		errorOutput << QStringLiteral("Failed to create temporary directory\n");
+
+		return 1;
+	}
+
+	QVector<ContentBlockingCompiledProfile*> profiles;
+	QStringList names;
+	QElapsedTimer timer;
+
+	for (int i = 0; i < paths.count(); ++i)
+	{
+		const QString path = QDir(temporaryDirectory.path()).filePath(QStringLiteral("%1-%2").arg(i).arg(QFileInfo(paths.at(i)).fileName()));
+
+		if (!QFile::copy(paths.at(i), path))
+		{
+			errorOutput << QStringLiteral("Failed to copy content blocking profile: %1\n").arg(paths.at(i));
+
+			continue;
+		}
+
+		timer.start();
+
+		const QByteArray data = ContentBlockingCompiledProfile::compile(path);
+		ContentBlockingCompiledProfile *profile = new ContentBlockingCompiledProfile(data);
+		const qint64 compilationTime = timer.elapsed();
+
+		if (!profile->isValid())
+		{
+			errorOutput << QStringLiteral("Failed to compile content blocking profile: %1\n").arg(paths.at(i));
+
+			delete profile;
+
+			continue;
+		}
+
+		errorOutput << QStringLiteral("Profile %1: compiled in %2 ms, %3 bytes").arg(QFileInfo(paths.at(i)).baseName()).arg(compilationTime).arg(data.size());
+
+		if (ContentBlockingCompiledProfile::save(data, path))
+		{
+			timer.start();
+
+			ContentBlockingCompiledProfile *cachedProfile = ContentBlockingCompiledProfile::load(path);
+			const qint64 loadingTime = timer.elapsed();
+
+			if (cachedProfile)
+			{
+				errorOutput << QStringLiteral(", cache mapped in %1 ms").arg(loadingTime);
+
+				delete cachedProfile;
+			}
+		}
+
+		errorOutput << QLatin1Char('\n');
+
+		profiles.append(profile);
+		names.append(QFileInfo(paths.at(i)).baseName());
+	}
+
+	QTextStream stream(&file);
+	QVector<qint64> latencies;
+	qint64 totalTime = 0;
+	int blockedRequests = 0;
+
+	while (!stream.atEnd())
+	{
+		const QString line = stream.readLine();
+
+		if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+		{
+			continue;
+		}
+
+		const QStringList fields = line.split(QLatin1Char('\t'));
+		const QUrl baseUrl(fields.value(1));
+		QNetworkRequest request(QUrl(fields.at(0)));
+		QString blockingProfile;
+
+		if (fields.count() > 2)
+		{
+			request.setRawHeader(QByteArray("Accept"), fields.at(2).toLatin1());
+		}
+
+		timer.start();
+
+		for (int i = 0; i < profiles.count(); ++i)
+		{
+			if (profiles.at(i)->isUrlBlocked(request, baseUrl))
+			{
+				blockingProfile = names.at(i);
+
+				break;
+			}
+		}
+
+		const qint64 latency = timer.nsecsElapsed();
+
+		latencies.append(latency);
+
+		totalTime += latency;
+
+		if (!blockingProfile.isEmpty())
+		{
+			++blockedRequests;
+		}
+
+		output << (blockingProfile.isEmpty() ? QLatin1String("allow") : QLatin1String("block")) << QLatin1Char('\t') << fields.at(0) << QLatin1Char('\t') << fields.value(1) << QLatin1Char('\t') << blockingProfile << QLatin1Char('\n');
+	}
+
+	file.close();
+
+	qDeleteAll(profiles);
+
+	if (latencies.isEmpty())
+	{
+		errorOutput << QStringLiteral("No requests found\n");
+
+		return 1;
+	}
+
+	qSort(latencies);
+
+	errorOutput << QStringLiteral("Requests: %1, blocked: %2\n").arg(latencies.count()).arg(blockedRequests);
+	errorOutput << QStringLiteral("Total matching time: %1 ms\n").arg(QString::number(totalTime / 1000000.0, 'f', 3));
+	errorOutput << QStringLiteral("Latency (us): p50 %1, p90 %2, p99 %3, max %4\n").arg(getPercentile(latencies, 50)).arg(getPercentile(latencies, 90)).arg(getPercentile(latencies, 99)).arg(getPercentile(latencies, 100));
+
+	return 0;
+}
+
+QString ContentBlockingBenchmark::getPercentile(const QVector<qint64> &latencies, int percentile)
+{
+	const int index = qMin((latencies.count() * percentile) / 100, (latencies.count() - 1));
+
+	return QString::number(latencies.at(index) / 1000.0, 'f', 2);
+}
+
+}
@@ -0,0 +1,1215 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "ContentBlockingCompiledProfile.h"
+#include "ContentBlockingManager.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMap>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTextStream>
+
+#include <cstring>
+
+namespace Otter
+{
+
+const quint32 ContentBlockingCompiledProfile::m_magic = 0x4F544342;
+const quint32 ContentBlockingCompiledProfile::m_version = 7;
+const quint32 ContentBlockingCompiledProfile::m_invalidIndex = 0xFFFFFFFF;
+
+void ContentBlockingCompiledProfile::CompilationData::addRule(const QString &keyword, const Rule &rule)
+{
+	quint32 state = 0;
+
+	for (int i = 0; i < keyword.length(); ++i)
+	{
+		const quint64 transition = ((static_cast<quint64>(state) << 16) | keyword.at(i).unicode());
+		const QHash<quint64, quint32>::const_iterator iterator = transitions.constFind(transition);
+
+		if (iterator == transitions.constEnd())
+		{
+			state = stateCount;
+
+			++stateCount;
+
+			transitions.insert(transition, state);
+		}
+		else
+		{
+			state = iterator.value();
+		}
+	}
+
+	rules.append(rule);
+	ruleStates.append(state);
+}
+
+quint32 ContentBlockingCompiledProfile::CompilationData::addString(const QString &string)
+{
+	const QHash<QString, quint32>::const_iterator iterator = stringIndexes.constFind(string);
+
+	if (iterator != stringIndexes.constEnd())
+	{
+		return iterator.value();
+	}
+
+	String entry;
+	entry.offset = characters.length();
+	entry.length = string.length();
+
+	characters.append(string);
+
+	strings.append(entry);
+
+	stringIndexes[string] = (strings.count() - 1);
+
+	return (strings.count() - 1);
+}
+
+ContentBlockingCompiledProfile::ContentBlockingCompiledProfile(const QByteArray &data) :
+	m_file(NULL),
+	m_mappedData(NULL),
+	m_data(data),
+	m_header(NULL),
+	m_states(NULL),
+	m_edges(NULL),
+	m_rules(NULL),
+	m_domains(NULL),
+	m_strings(NULL),
+	m_hosts(NULL),
+	m_characters(NULL)
+{
+	initialize(reinterpret_cast<const uchar*>(m_data.constData()), m_data.size());
+}
+
+ContentBlockingCompiledProfile::ContentBlockingCompiledProfile(QFile *file, uchar *data, qint64 size) :
+	m_file(file),
+	m_mappedData(data),
+	m_header(NULL),
+	m_states(NULL),
+	m_edges(NULL),
+	m_rules(NULL),
+	m_domains(NULL),
+	m_strings(NULL),
+	m_hosts(NULL),
+	m_characters(NULL)
+{
+	initialize(data, size);
+}
+
+ContentBlockingCompiledProfile::~ContentBlockingCompiledProfile()
+{
+	if (m_file)
+	{
+		m_file->unmap(m_mappedData);
+		m_file->close();
+
+		delete m_file;
+	}
+}
+
+void ContentBlockingCompiledProfile::initialize(const uchar *data, qint64 size)
+{
+	if (size < static_cast<qint64>(sizeof(Header)))
+	{
+		return;
+	}
+
+	const Header *header = reinterpret_cast<const Header*>(data);
+
+	if (header->magic != m_magic || header->version != m_version || header->stateCount == 0)
+	{
+		return;
+	}
+
+	qint64 offset = sizeof(Header);
+
+	m_states = reinterpret_cast<const State*>(data + offset);
+
+	offset += (static_cast<qint64>(header->stateCount) * sizeof(State));
+
+	m_edges = reinterpret_cast<const Edge*>(data + offset);
+
+	offset += (static_cast<qint64>(header->edgeCount) * sizeof(Edge));
+
+	m_rules = reinterpret_cast<const Rule*>(data + offset);
+
+	offset += (static_cast<qint64>(header->ruleCount) * sizeof(Rule));
+
+	m_domains = reinterpret_cast<const quint32*>(data + offset);
+
+	offset += (static_cast<qint64>(header->domainCount) * sizeof(quint32));
+
+	m_strings = reinterpret_cast<const String*>(data + offset);
+
+	offset += (static_cast<qint64>(header->stringCount) * sizeof(String));
+
+	m_hosts = reinterpret_cast<const Host*>(data + offset);
+
+	offset += (static_cast<qint64>(header->hostCount) * sizeof(Host));
+
+	m_characters = reinterpret_cast<const QChar*>(data + offset);
+
+	offset += (static_cast<qint64>(header->characterCount) * sizeof(QChar));
+
+	if (offset != size || header->styleSheet >= header->stringCount || header->hostCount == 0 || (header->hostCount & (header->hostCount - 1)) != 0)
+	{
+		return;
+	}
+
+	m_header = header;
+}
+
+void ContentBlockingCompiledProfile::parseRuleLine(QString line, CompilationData &compilationData)
+{
+	if (line.indexOf(QLatin1Char('!')) == 0 || line.isEmpty())
+	{
+		return;
+	}
+
+	if (line.startsWith(QLatin1String("##")))
+	{
+		if (isSupportedSelector(line.mid(2)))
+		{
+			compilationData.styleSheet.append(line.mid(2));
+		}
+
+		return;
+	}
+
+	if (line.contains(QLatin1String("##")))
+	{
+		parseStyleSheetRule(line.split(QLatin1String("##")), compilationData.styleSheetBlackList, compilationData);
+
+		return;
+	}
+
+	if (line.contains(QLatin1String("#@#")))
+	{
+		parseStyleSheetRule(line.split(QLatin1String("#@#")), compilationData.styleSheetWhiteList, compilationData);
+
+		return;
+	}
+
+	const int optionSeparator = line.indexOf(QLatin1Char('$'));
+	QStringList options;
+
+	if (optionSeparator >= 0)
+	{
+		options = line.mid(optionSeparator + 1).split(QLatin1Char(','), QString::SkipEmptyParts);
+
+		line = line.left(optionSeparator);
+	}
+
+	Rule rule;
+	rule.ruleOption = ContentBlockingProfile::NoOption;
+	rule.exceptionRuleOption = ContentBlockingProfile::NoOption;
+	rule.flags = NoFlag;
+	rule.line = compilationData.line;
+
+	QStringList blockedDomains;
+	QStringList allowedDomains;
+	bool needsDomainCheck = false;
+	bool needsStartCheck = false;
+	bool needsEndCheck = false;
+
+	if (line.startsWith(QLatin1String("@@")))
+	{
+		line = line.mid(2);
+
+		rule.flags |= ExceptionFlag;
+	}
+
+	if (line.startsWith(QLatin1String("||")))
+	{
+		line = line.mid(2);
+
+		needsDomainCheck = true;
+	}
+	else if (line.startsWith(QLatin1Char('|')))
+	{
+		line = line.mid(1);
+
+		needsStartCheck = true;
+	}
+
+	if (line.endsWith(QLatin1Char('|')))
+	{
+		line = line.left(line.length() - 1);
+
+		needsEndCheck = true;
+	}
+
+	while (line.startsWith(QLatin1Char('*')))
+	{
+		line = line.mid(1);
+
+		needsDomainCheck = false;
+		needsStartCheck = false;
+	}
+
+	while (line.endsWith(QLatin1Char('*')))
+	{
+		line = line.left(line.length() - 1);
+
+		needsEndCheck = false;
+	}
+
+	for (int i = 0; i < options.count(); ++i)
+	{
+		const bool optionException = options.at(i).startsWith(QLatin1Char('~'));
+
+		if (options.at(i).contains(QLatin1String("third-party")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::ThirdPartyOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::ThirdPartyOption : ContentBlockingProfile::NoOption);
+		}
+		else if (options.at(i).contains(QLatin1String("stylesheet")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::StyleSheetOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::StyleSheetOption : ContentBlockingProfile::NoOption);
+		}
+		else if (options.at(i).contains(QLatin1String("image")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::ImageOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::ImageOption : ContentBlockingProfile::NoOption);
+		}
+		else if (options.at(i).contains(QLatin1String("script")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::ScriptOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::ScriptOption : ContentBlockingProfile::NoOption);
+		}
+		else if (options.at(i).contains(QLatin1String("object")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::ObjectOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::ObjectOption : ContentBlockingProfile::NoOption);
+		}
+		else if (options.at(i).contains(QLatin1String("object-subrequest")) || options.at(i).contains(QLatin1String("object_subrequest")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::ObjectSubRequestOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::ObjectSubRequestOption : ContentBlockingProfile::NoOption);
+			// TODO
+			return;
+		}
+		else if (options.at(i).contains(QLatin1String("subdocument")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::SubDocumentOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::SubDocumentOption : ContentBlockingProfile::NoOption);
+			// TODO
+			return;
+		}
+		else if (options.at(i).contains(QLatin1String("xmlhttprequest")))
+		{
+			rule.ruleOption |= ContentBlockingProfile::XmlHttpRequestOption;
+			rule.exceptionRuleOption |= (optionException ? ContentBlockingProfile::XmlHttpRequestOption : ContentBlockingProfile::NoOption);
+		}
+		else if (options.at(i).contains(QLatin1String("domain")))
+		{
+			const QStringList parsedDomains = options.at(i).mid(options.at(i).indexOf(QLatin1Char('=')) + 1).split(QLatin1Char('|'), QString::SkipEmptyParts);
+
+			for (int j = 0; j < parsedDomains.count(); ++j)
+			{
+				if (parsedDomains.at(j).startsWith(QLatin1Char('~')))
+				{
+					allowedDomains.append(parsedDomains.at(j).mid(1));
+
+					continue;
+				}
+
+				blockedDomains.append(parsedDomains.at(j));
+			}
+		}
+		else
+		{
+			// TODO - document, elemhide
+			return;
+		}
+	}
+
+	QString keyword;
+	int keywordStart = 0;
+
+	for (int i = 0; i <= line.length(); ++i)
+	{
+		if (i == line.length() || line.at(i) == QLatin1Char('*') || line.at(i) == QLatin1Char('^'))
+		{
+			if ((i - keywordStart) > keyword.length())
+			{
+				keyword = line.mid(keywordStart, (i - keywordStart));
+			}
+
+			keywordStart = (i + 1);
+		}
+	}
+
+	if (keyword.isEmpty())
+	{
+		return;
+	}
+
+	if (needsDomainCheck)
+	{
+		rule.flags |= DomainCheckFlag;
+	}
+
+	if (needsStartCheck)
+	{
+		rule.flags |= StartCheckFlag;
+	}
+
+	if (needsEndCheck)
+	{
+		rule.flags |= EndCheckFlag;
+	}
+
+	if (needsDomainCheck || needsStartCheck || needsEndCheck || keyword.length() != line.length())
+	{
+		rule.flags |= PatternCheckFlag;
+	}
+
+	rule.pattern = compilationData.addString(line);
+	rule.blockedDomainsOffset = compilationData.domains.count();
+	rule.blockedDomainsCount = blockedDomains.count();
+
+	for (int i = 0; i < blockedDomains.count(); ++i)
+	{
+		compilationData.domains.append(compilationData.addString(blockedDomains.at(i)));
+	}
+
+	rule.allowedDomainsOffset = compilationData.domains.count();
+	rule.allowedDomainsCount = allowedDomains.count();
+
+	for (int i = 0; i < allowedDomains.count(); ++i)
+	{
+		compilationData.domains.append(compilationData.addString(allowedDomains.at(i)));
+	}
+
+	qSort((compilationData.domains.begin() + rule.blockedDomainsOffset), (compilationData.domains.begin() + rule.allowedDomainsOffset));
+	qSort((compilationData.domains.begin() + rule.allowedDomainsOffset), compilationData.domains.end());
+
+	if (needsDomainCheck && !needsEndCheck && line.length() > 1 && line.endsWith(QLatin1Char('^')) && isHost(line.left(line.length() - 1)))
+	{
+		compilationData.hostRules.append(rule);
+		compilationData.hostRuleHosts.append(compilationData.addString(line.left(line.length() - 1)));
+
+		return;
+	}
+
+	compilationData.addRule(keyword, rule);
+}
+
+void ContentBlockingCompiledProfile::parseStyleSheetRule(const QStringList &line, QHash<quint32, QStringList> &list, CompilationData &compilationData)
+{
+	if (!isSupportedSelector(line.at(1)))
+	{
+		return;
+	}
+
+	const QStringList domains = line.at(0).split(QLatin1Char(','));
+
+	for (int i = 0; i < domains.count(); ++i)
+	{
+		if (domains.at(i).isEmpty() || domains.at(i).startsWith(QLatin1Char('~')))
+		{
+			continue;
+		}
+
+		QStringList &selectors = list[compilationData.addString(domains.at(i))];
+
+		if (!selectors.contains(line.at(1)))
+		{
+			selectors.append(line.at(1));
+		}
+	}
+}
+
+void ContentBlockingCompiledProfile::buildAutomaton(QVector<State> &states, const QVector<Edge> &edgesVector)
+{
+	const Edge *edges = edgesVector.constData();
+
+	for (int i = 0; i < states.count(); ++i)
+	{
+		for (quint32 j = 0; j < states.at(i).edgeCount; ++j)
+		{
+			const Edge &edge = edges[states.at(i).edgeOffset + j];
+			quint32 failureState = 0;
+
+			if (i > 0)
+			{
+				quint32 state = states.at(i).failureState;
+
+				while (true)
+				{
+					failureState = getState(edges, states.at(state), edge.value);
+
+					if (failureState > 0 || state == 0)
+					{
+						break;
+					}
+
+					state = states.at(state).failureState;
+				}
+			}
+
+			states[edge.state].failureState = failureState;
+			states[edge.state].outputState = ((states.at(failureState).ruleCount > 0) ? failureState : states.at(failureState).outputState);
+		}
+	}
+}
+
+ContentBlockingCompiledProfile* ContentBlockingCompiledProfile::load(const QString &sourcePath, bool *isOutdated)
+{
+	QFile *file = new QFile(getPath(sourcePath));
+
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		delete file;
+
+		return NULL;
+	}
+
+	const qint64 size = file->size();
+	uchar *data = ((size >= static_cast<qint64>(sizeof(Header))) ? file->map(0, size) : NULL);
+
+	if (!data)
+	{
+		delete file;
+
+		return NULL;
+	}
+
+	ContentBlockingCompiledProfile *profile = new ContentBlockingCompiledProfile(file, data, size);
+
+	if (!profile->isValid())
+	{
+		delete profile;
+
+		return NULL;
+	}
+
+	const bool isCurrent = profile->isCurrent(sourcePath);
+
+	if (isOutdated)
+	{
+		*isOutdated = !isCurrent;
+	}
+	else if (!isCurrent)
+	{
+		delete profile;
+
+		return NULL;
+	}
+
+	return profile;
+}
+
+const ContentBlockingCompiledProfile::Host* ContentBlockingCompiledProfile::getHost(const QString &host) const
+{
+	const quint32 mask = (m_header->hostCount - 1);
+
+	for (quint32 position = (getHash(host) & mask); m_hosts[position].string != m_invalidIndex; position = ((position + 1) & mask))
+	{
+		if (getString(m_hosts[position].string) == host)
+		{
+			return &m_hosts[position];
+		}
+	}
+
+	return NULL;
+}
+
+QString ContentBlockingCompiledProfile::getPath(const QString &sourcePath)
+{
+	const QFileInfo information(sourcePath);
+
+	return information.absoluteDir().filePath(information.baseName() + QLatin1String(".dat"));
+}
+
+QString ContentBlockingCompiledProfile::getString(quint32 index) const
+{
+	const String &string = m_strings[index];
+
+	return QString::fromRawData((m_characters + string.offset), string.length);
+}
+
+QString ContentBlockingCompiledProfile::getStyleSheet() const
+{
+	if (!m_header)
+	{
+		return QString();
+	}
+
+	const String &string = m_strings[m_header->styleSheet];
+
+	return QString((m_characters + string.offset), string.length);
+}
+
+QByteArray ContentBlockingCompiledProfile::compile(const QString &sourcePath)
+{
+	QFile file(sourcePath);
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return QByteArray();
+	}
+
+	CompilationData compilationData;
+	QTextStream stream(&file);
+
+	stream.readLine(); // header
+
+	while (!stream.atEnd())
+	{
+		++compilationData.line;
+
+		parseRuleLine(stream.readLine(), compilationData);
+	}
+
+	file.close();
+
+	return createData(compilationData, sourcePath);
+}
+
+QByteArray ContentBlockingCompiledProfile::compileRules(const QStringList &rules)
+{
+	CompilationData compilationData;
+
+	for (int i = 0; i < rules.count(); ++i)
+	{
+		++compilationData.line;
+
+		parseRuleLine(rules.at(i), compilationData);
+	}
+
+	return createData(compilationData, QString());
+}
+
+QByteArray ContentBlockingCompiledProfile::createData(CompilationData &compilationData, const QString &sourcePath)
+{
+	QVector<quint64> transitions;
+	transitions.reserve(compilationData.transitions.count());
+
+	QHash<quint64, quint32>::const_iterator iterator;
+
+	for (iterator = compilationData.transitions.constBegin(); iterator != compilationData.transitions.constEnd(); ++iterator)
+	{
+		transitions.append(iterator.key());
+	}
+
+	qSort(transitions);
+
+	QVector<quint32> transitionOffsets(compilationData.stateCount + 1, 0);
+	QVector<quint32> ruleOffsets(compilationData.stateCount + 1, 0);
+
+	for (int i = 0; i < transitions.count(); ++i)
+	{
+		++transitionOffsets[(transitions.at(i) >> 16) + 1];
+	}
+
+	for (int i = 0; i < compilationData.ruleStates.count(); ++i)
+	{
+		++ruleOffsets[compilationData.ruleStates.at(i) + 1];
+	}
+
+	for (quint32 i = 1; i <= compilationData.stateCount; ++i)
+	{
+		transitionOffsets[i] += transitionOffsets.at(i - 1);
+		ruleOffsets[i] += ruleOffsets.at(i - 1);
+	}
+
+	QVector<quint32> ruleIndexes(compilationData.rules.count());
+	QVector<quint32> ruleInsertPositions(ruleOffsets);
+
+	for (int i = 0; i < compilationData.ruleStates.count(); ++i)
+	{
+		ruleIndexes[ruleInsertPositions[compilationData.ruleStates.at(i)]++] = i;
+	}
+
+	QVector<State> states;
+	QVector<Edge> edges;
+	QVector<Rule> rules;
+	QVector<quint32> order;
+
+	states.reserve(compilationData.stateCount);
+	edges.reserve(transitions.count());
+	rules.reserve(compilationData.rules.count());
+	order.reserve(compilationData.stateCount);
+	order.append(0);
+
+	for (int i = 0; i < order.count(); ++i)
+	{
+		const quint32 sourceState = order.at(i);
+		State state;
+		state.edgeOffset = edges.count();
+		state.edgeCount = (transitionOffsets.at(sourceState + 1) - transitionOffsets.at(sourceState));
+		state.ruleOffset = rules.count();
+		state.ruleCount = (ruleOffsets.at(sourceState + 1) - ruleOffsets.at(sourceState));
+		state.failureState = 0;
+		state.outputState = 0;
+
+		for (quint32 j = transitionOffsets.at(sourceState); j < transitionOffsets.at(sourceState + 1); ++j)
+		{
+			Edge edge;
+			edge.state = order.count();
+			edge.value = (transitions.at(j) & 0xFFFF);
+			edge.reserved = 0;
+
+			edges.append(edge);
+
+			order.append(compilationData.transitions.value(transitions.at(j)));
+		}
+
+		for (quint32 j = ruleOffsets.at(sourceState); j < ruleOffsets.at(sourceState + 1); ++j)
+		{
+			rules.append(compilationData.rules.at(ruleIndexes.at(j)));
+		}
+
+		states.append(state);
+	}
+
+	compilationData.transitions.clear();
+
+	buildAutomaton(states, edges);
+
+	QMap<quint32, QVector<quint32> > hostRules;
+
+	for (int i = 0; i < compilationData.domains.count(); ++i)
+	{
+		hostRules[compilationData.domains.at(i)];
+	}
+
+	for (int i = 0; i < compilationData.hostRuleHosts.count(); ++i)
+	{
+		hostRules[compilationData.hostRuleHosts.at(i)].append(i);
+	}
+
+	QHash<quint32, QStringList>::const_iterator styleSheetIterator;
+
+	for (styleSheetIterator = compilationData.styleSheetBlackList.constBegin(); styleSheetIterator != compilationData.styleSheetBlackList.constEnd(); ++styleSheetIterator)
+	{
+		hostRules[styleSheetIterator.key()];
+	}
+
+	for (styleSheetIterator = compilationData.styleSheetWhiteList.constBegin(); styleSheetIterator != compilationData.styleSheetWhiteList.constEnd(); ++styleSheetIterator)
+	{
+		hostRules[styleSheetIterator.key()];
+	}
+
+	quint32 hostCount = 1;
+
+	while (hostCount < static_cast<quint32>(hostRules.count() * 2))
+	{
+		hostCount *= 2;
+	}
+
+	QVector<Host> hosts(hostCount);
+
+	for (int i = 0; i < hosts.count(); ++i)
+	{
+		hosts[i].string = m_invalidIndex;
+		hosts[i].ruleOffset = 0;
+		hosts[i].ruleCount = 0;
+		hosts[i].styleSheetBlackList = m_invalidIndex;
+		hosts[i].styleSheetWhiteList = m_invalidIndex;
+	}
+
+	QMap<quint32, QVector<quint32> >::const_iterator hostsIterator;
+
+	for (hostsIterator = hostRules.constBegin(); hostsIterator != hostRules.constEnd(); ++hostsIterator)
+	{
+		const quint32 styleSheetBlackList = (compilationData.styleSheetBlackList.contains(hostsIterator.key()) ? compilationData.addString(compilationData.styleSheetBlackList.value(hostsIterator.key()).join(QLatin1Char(','))) : m_invalidIndex);
+		const quint32 styleSheetWhiteList = (compilationData.styleSheetWhiteList.contains(hostsIterator.key()) ? compilationData.addString(compilationData.styleSheetWhiteList.value(hostsIterator.key()).join(QLatin1Char(','))) : m_invalidIndex);
+		const String string = compilationData.strings.at(hostsIterator.key());
+		quint32 position = (getHash(QString::fromRawData((compilationData.characters.constData() + string.offset), string.length)) & (hostCount - 1));
+
+		while (hosts.at(position).string != m_invalidIndex)
+		{
+			position = ((position + 1) & (hostCount - 1));
+		}
+
+		hosts[position].string = hostsIterator.key();
+		hosts[position].ruleOffset = rules.count();
+		hosts[position].ruleCount = hostsIterator.value().count();
+		hosts[position].styleSheetBlackList = styleSheetBlackList;
+		hosts[position].styleSheetWhiteList = styleSheetWhiteList;
+
+		for (int i = 0; i < hostsIterator.value().count(); ++i)
+		{
+			rules.append(compilationData.hostRules.at(hostsIterator.value().at(i)));
+		}
+	}
+
+	compilationData.styleSheet.removeDuplicates();
+
+	const quint32 styleSheet = compilationData.addString(compilationData.styleSheet.isEmpty() ? QString() : (compilationData.styleSheet.join(QLatin1Char(',')) + QLatin1String("{display:none;}")));
+	const QFileInfo information(sourcePath);
+	Header header;
+
+	memset(&header, 0, sizeof(Header));
+
+	header.magic = m_magic;
+	header.version = m_version;
+	header.sourceSize = information.size();
+	header.sourceModificationTime = information.lastModified().toMSecsSinceEpoch();
+	header.stateCount = states.count();
+	header.edgeCount = edges.count();
+	header.ruleCount = rules.count();
+	header.domainCount = compilationData.domains.count();
+	header.stringCount = compilationData.strings.count();
+	header.hostCount = hosts.count();
+	header.characterCount = compilationData.characters.length();
+	header.styleSheet = styleSheet;
+
+	QByteArray data;
+	data.reserve(sizeof(Header) + (header.stateCount * sizeof(State)) + (header.edgeCount * sizeof(Edge)) + (header.ruleCount * sizeof(Rule)) + (header.domainCount * sizeof(quint32)) + (header.stringCount * sizeof(String)) + (header.hostCount * sizeof(Host)) + (header.characterCount * sizeof(QChar)));
+	data.append(reinterpret_cast<const char*>(&header), sizeof(Header));
+	data.append(reinterpret_cast<const char*>(states.constData()), (states.count() * sizeof(State)));
+	data.append(reinterpret_cast<const char*>(edges.constData()), (edges.count() * sizeof(Edge)));
+	data.append(reinterpret_cast<const char*>(rules.constData()), (rules.count() * sizeof(Rule)));
+	data.append(reinterpret_cast<const char*>(compilationData.domains.constData()), (compilationData.domains.count() * sizeof(quint32)));
+	data.append(reinterpret_cast<const char*>(compilationData.strings.constData()), (compilationData.strings.count() * sizeof(String)));
+	data.append(reinterpret_cast<const char*>(hosts.constData()), (hosts.count() * sizeof(Host)));
+	data.append(reinterpret_cast<const char*>(compilationData.characters.constData()), (compilationData.characters.length() * sizeof(QChar)));
+
+	return data;
+}
+
+QString ContentBlockingCompiledProfile::getStyleSheetList(const QString &host, bool isBlackList) const
+{
+	if (!m_header)
+	{
+		return QString();
+	}
+
+	QString styleSheet;
+	int position = 0;
+
+	while (position >= 0)
+	{
+		const Host *entry = getHost(QString::fromRawData((host.constData() + position), (host.length() - position)));
+
+		if (entry)
+		{
+			const quint32 selectors = (isBlackList ? entry->styleSheetBlackList : entry->styleSheetWhiteList);
+
+			if (selectors != m_invalidIndex)
+			{
+				if (!styleSheet.isEmpty())
+				{
+					styleSheet += QLatin1Char(',');
+				}
+
+				styleSheet += getString(selectors);
+			}
+		}
+
+		position = host.indexOf(QLatin1Char('.'), position);
+
+		if (position >= 0)
+		{
+			++position;
+		}
+	}
+
+	return styleSheet;
+}
+
+QString ContentBlockingCompiledProfile::getStyleSheetBlackList(const QString &host) const
+{
+	return getStyleSheetList(host, true);
+}
+
+QString ContentBlockingCompiledProfile::getStyleSheetWhiteList(const QString &host) const
+{
+	return getStyleSheetList(host, false);
+}
+
+quint32 ContentBlockingCompiledProfile::getHash(const QString &string)
+{
+	quint32 hash = 2166136261U;
+
+	for (int i = 0; i < string.length(); ++i)
+	{
+		hash ^= string.at(i).unicode();
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+quint32 ContentBlockingCompiledProfile::getState(const Edge *edges, const State &state, ushort value)
+{
+	int first = state.edgeOffset;
+	int last = (static_cast<int>(state.edgeOffset + state.edgeCount) - 1);
+
+	while (first <= last)
+	{
+		const int middle = ((first + last) / 2);
+
+		if (edges[middle].value == value)
+		{
+			return edges[middle].state;
+		}
+
+		if (edges[middle].value < value)
+		{
+			first = (middle + 1);
+		}
+		else
+		{
+			last = (middle - 1);
+		}
+	}
+
+	return 0;
+}
+
+ContentBlockingCompiledProfile::MatchResult ContentBlockingCompiledProfile::checkUrl(const QNetworkRequest &request, const QUrl &baseUrl) const
+{
+	if (!m_header)
+	{
+		return NoMatchResult;
+	}
+
+	const QString host = request.url().host();
+	RequestInformation information;
+	information.url = request.url().url();
+	information.baseHost = baseUrl.host();
+	information.subdomains = ContentBlockingManager::createSubdomainList(host);
+	information.options = ContentBlockingProfile::getRequestOptions(request);
+	information.hostPosition = (host.isEmpty() ? -1 : information.url.indexOf(host));
+
+	const QStringList baseHostSubdomains = ContentBlockingManager::createSubdomainList(information.baseHost);
+
+	for (int i = 0; i < baseHostSubdomains.count(); ++i)
+	{
+		const Host *baseHost = getHost(baseHostSubdomains.at(i));
+
+		if (baseHost)
+		{
+			information.baseHostDomains.append(baseHost->string);
+		}
+	}
+
+	bool isBlocked = false;
+
+	for (int i = 0; i < information.subdomains.count(); ++i)
+	{
+		const Host *requestHost = getHost(information.subdomains.at(i));
+
+		if (!requestHost)
+		{
+			continue;
+		}
+
+		for (quint32 j = 0; j < requestHost->ruleCount; ++j)
+		{
+			const Rule &rule = m_rules[requestHost->ruleOffset + j];
+			const bool isException = (rule.flags & ExceptionFlag);
+
+			if ((!isBlocked || isException) && !isMasked(rule) && resolveRuleOptions(rule, information))
+			{
+				if (isException)
+				{
+					return ExceptionMatchResult;
+				}
+
+				isBlocked = true;
+			}
+		}
+	}
+
+	quint32 state = 0;
+
+	for (int i = 0; i < information.url.length(); ++i)
+	{
+		const ushort value = information.url.at(i).unicode();
+		quint32 nextState = getState(m_edges, m_states[state], value);
+
+		while (nextState == 0 && state != 0)
+		{
+			state = m_states[state].failureState;
+			nextState = getState(m_edges, m_states[state], value);
+		}
+
+		state = nextState;
+
+		for (quint32 matchState = ((m_states[state].ruleCount > 0) ? state : m_states[state].outputState); matchState != 0; matchState = m_states[matchState].outputState)
+		{
+			const State &currentState = m_states[matchState];
+
+			for (quint32 j = 0; j < currentState.ruleCount; ++j)
+			{
+				const Rule &rule = m_rules[currentState.ruleOffset + j];
+				const bool isException = (rule.flags & ExceptionFlag);
+
+				if ((!isBlocked || isException) && !isMasked(rule) && checkRuleMatch(rule, information))
+				{
+					if (isException)
+					{
+						return ExceptionMatchResult;
+					}
+
+					isBlocked = true;
+				}
+			}
+		}
+	}
+
+	return (isBlocked ? BlockMatchResult : NoMatchResult);
+}
+
+void ContentBlockingCompiledProfile::setMaskedLines(const QSet<quint32> &lines)
+{
+	m_maskedLines = lines;
+}
+
+bool ContentBlockingCompiledProfile::save(const QByteArray &data, const QString &sourcePath)
+{
+	QSaveFile file(getPath(sourcePath));
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return false;
+	}
+
+	file.write(data);
+
+	return file.commit();
+}
+
+bool ContentBlockingCompiledProfile::resolveDomainExceptions(const QVector<quint32> &domains, quint32 offset, quint32 count) const
+{
+	const quint32 *first = (m_domains + offset);
+	const quint32 *last = (first + count);
+
+	for (int i = 0; i < domains.count(); ++i)
+	{
+		if (qBinaryFind(first, last, domains.at(i)) != last)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ContentBlockingCompiledProfile::resolveRuleOptions(const Rule &rule, const RequestInformation &information) const
+{
+	if (rule.allowedDomainsCount > 0 && resolveDomainExceptions(information.baseHostDomains, rule.allowedDomainsOffset, rule.allowedDomainsCount))
+	{
+		return false;
+	}
+
+	if (rule.blockedDomainsCount > 0 && !resolveDomainExceptions(information.baseHostDomains, rule.blockedDomainsOffset, rule.blockedDomainsCount))
+	{
+		return false;
+	}
+
+	if (rule.ruleOption & ContentBlockingProfile::ThirdPartyOption)
+	{
+		const bool isThirdParty = !(information.baseHost.isEmpty() || information.subdomains.contains(information.baseHost));
+
+		if (isThirdParty == static_cast<bool>(rule.exceptionRuleOption & ContentBlockingProfile::ThirdPartyOption))
+		{
+			return false;
+		}
+	}
+
+	const int typeOptions = (rule.ruleOption & ~ContentBlockingProfile::ThirdPartyOption);
+	const int includedTypeOptions = (typeOptions & ~rule.exceptionRuleOption);
+	const int excludedTypeOptions = (typeOptions & rule.exceptionRuleOption);
+
+	if (information.options & excludedTypeOptions)
+	{
+		return false;
+	}
+
+	return (includedTypeOptions == ContentBlockingProfile::NoOption || (information.options & includedTypeOptions));
+}
+
+bool ContentBlockingCompiledProfile::checkRuleMatch(const Rule &rule, const RequestInformation &information) const
+{
+	if (rule.flags & DomainCheckFlag)
+	{
+		if (information.hostPosition < 0)
+		{
+			return false;
+		}
+
+		const QString pattern = getString(rule.pattern);
+		const int hostEnd = (information.hostPosition + information.subdomains.last().length());
+		bool hasMatch = false;
+
+		for (int i = 0; i < information.subdomains.count(); ++i)
+		{
+			if (matchPattern(pattern, information.url, (hostEnd - information.subdomains.at(i).length()), true, (rule.flags & EndCheckFlag)))
+			{
+				hasMatch = true;
+
+				break;
+			}
+		}
+
+		if (!hasMatch)
+		{
+			return false;
+		}
+	}
+	else if ((rule.flags & PatternCheckFlag) && !matchPattern(getString(rule.pattern), information.url, 0, (rule.flags & StartCheckFlag), (rule.flags & EndCheckFlag)))
+	{
+		return false;
+	}
+
+	return resolveRuleOptions(rule, information);
+}
+
+bool ContentBlockingCompiledProfile::matchPattern(const QString &pattern, const QString &url, int position, bool matchStart, bool matchEnd)
+{
+	int patternPosition = 0;
+	int wildcardPatternPosition = (matchStart ? -1 : 0);
+	int wildcardPosition = position;
+
+	while (true)
+	{
+		if (patternPosition == pattern.length())
+		{
+			if (!matchEnd || position == url.length())
+			{
+				return true;
+			}
+		}
+		else
+		{
+			const QChar character = pattern.at(patternPosition);
+
+			if (character == QLatin1Char('*'))
+			{
+				++patternPosition;
+
+				wildcardPatternPosition = patternPosition;
+				wildcardPosition = position;
+
+				continue;
+			}
+
+			if (position < url.length())
+			{
+				if ((character == QLatin1Char('^')) ? isSeparator(url.at(position)) : (character == url.at(position)))
+				{
+					++patternPosition;
+					++position;
+
+					continue;
+				}
+			}
+			else if (character == QLatin1Char('^'))
+			{
+				++patternPosition;
+
+				continue;
+			}
+		}
+
+		if (wildcardPatternPosition < 0 || wildcardPosition >= url.length())
+		{
+			return false;
+		}
+
+		++wildcardPosition;
+
+		patternPosition = wildcardPatternPosition;
+		position = wildcardPosition;
+	}
+
+	return false;
+}
+
+bool ContentBlockingCompiledProfile::isSeparator(const QChar &character)
+{
+	return !(character.isLetterOrNumber() || character == QLatin1Char('_') || character == QLatin1Char('-') || character == QLatin1Char('.') || character == QLatin1Char('%'));
+}
+
+bool ContentBlockingCompiledProfile::isHost(const QString &string)
+{
+	for (int i = 0; i < string.length(); ++i)
+	{
+		const QChar character = string.at(i);
+
+		if (!(character.isLetterOrNumber() || character == QLatin1Char('.') || character == QLatin1Char('-')))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ContentBlockingCompiledProfile::isSupportedSelector(const QString &selector)
+{
+// selectors are joined into a single selector group, so one that WebKit fails to parse would disable all of them
+	if (selector.isEmpty() || selector.contains(QLatin1Char('{')) || selector.contains(QLatin1Char('}')) || selector.contains(QLatin1String("[-ext-")))
+	{
+		return false;
+	}
+
+	const QStringList extendedPseudoClasses = QStringList() << QLatin1String(":-abp-") << QLatin1String(":has(") << QLatin1String(":has-text(") << QLatin1String(":contains(") << QLatin1String(":xpath(") << QLatin1String(":matches-css") << QLatin1String(":style(") << QLatin1String(":if(") << QLatin1String(":if-not(") << QLatin1String(":upward(") << QLatin1String(":remove(") << QLatin1String(":nth-ancestor(") << QLatin1String(":min-text-length(") << QLatin1String(":watch-attr(");
+
+	for (int i = 0; i < extendedPseudoClasses.count(); ++i)
+	{
+		if (selector.contains(extendedPseudoClasses.at(i), Qt::CaseInsensitive))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ContentBlockingCompiledProfile::isMasked(const Rule &rule) const
+{
+	return (!m_maskedLines.isEmpty() && m_maskedLines.contains(rule.line));
+}
+
+bool ContentBlockingCompiledProfile::isCurrent(const QString &sourcePath) const
+{
+	const QFileInfo information(sourcePath);
+
+	if (!m_header || !information.exists())
+	{
+		return false;
+	}
+
+	return (m_header->sourceSize == information.size() && m_header->sourceModificationTime == information.lastModified().toMSecsSinceEpoch());
+}
+
+bool ContentBlockingCompiledProfile::isUrlBlocked(const QNetworkRequest &request, const QUrl &baseUrl) const
+{
+	return (checkUrl(request, baseUrl) == BlockMatchResult);
+}
+
+bool ContentBlockingCompiledProfile::isValid() const
+{
+	return (m_header != NULL);
+}
+
+}
@@ -0,0 +1,207 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_CONTENTBLOCKINGCOMPILEDPROFILE_H
+#define OTTER_CONTENTBLOCKINGCOMPILEDPROFILE_H
+
+#include "ContentBlockingProfile.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QVector>
+
+namespace Otter
+{
+
+class ContentBlockingCompiledProfile
+{
+public:
+	enum RuleFlag
+	{
+		NoFlag = 0,
+		ExceptionFlag = 1,
+		DomainCheckFlag = 2,
+		StartCheckFlag = 4,
+		EndCheckFlag = 8,
+		PatternCheckFlag = 16
+	};
+
+	enum MatchResult
+	{
+		NoMatchResult = 0,
+		BlockMatchResult,
+		ExceptionMatchResult
+	};
+
+	struct Header
+	{
+		quint32 magic;
+		quint32 version;
+		qint64 sourceSize;
+		qint64 sourceModificationTime;
+		quint32 stateCount;
+		quint32 edgeCount;
+		quint32 ruleCount;
+		quint32 domainCount;
+		quint32 stringCount;
+		quint32 hostCount;
+		quint32 characterCount;
+		quint32 styleSheet;
+	};
+
+	struct State
+	{
+		quint32 edgeOffset;
+		quint32 edgeCount;
+		quint32 ruleOffset;
+		quint32 ruleCount;
+		quint32 failureState;
+		quint32 outputState;
+	};
+
+	struct Edge
+	{
+		quint32 state;
+		quint16 value;
+		quint16 reserved;
+	};
+
+	struct Rule
+	{
+		quint32 pattern;
+		quint32 blockedDomainsOffset;
+		quint32 blockedDomainsCount;
+		quint32 allowedDomainsOffset;
+		quint32 allowedDomainsCount;
+		quint16 ruleOption;
+		quint16 exceptionRuleOption;
+		quint32 flags;
+		quint32 line;
+	};
+
+	struct String
+	{
+		quint32 offset;
+		quint32 length;
+	};
+
+	struct Host
+	{
+		quint32 string;
+		quint32 ruleOffset;
+		quint32 ruleCount;
+		quint32 styleSheetBlackList;
+		quint32 styleSheetWhiteList;
+	};
+
+	struct CompilationData
+	{
+		QVector<Rule> rules;
+		QVector<Rule> hostRules;
+		QVector<quint32> ruleStates;
+		QVector<quint32> hostRuleHosts;
+		QVector<quint32> domains;
+		QVector<String> strings;
+		QHash<quint32, QStringList> styleSheetBlackList;
+		QHash<quint32, QStringList> styleSheetWhiteList;
+		QHash<quint64, quint32> transitions;
+		QHash<QString, quint32> stringIndexes;
+		QStringList styleSheet;
+		QString characters;
+		quint32 stateCount;
+		quint32 line;
+
+		CompilationData() : stateCount(1), line(0) {}
+
+		void addRule(const QString &keyword, const Rule &rule);
+		quint32 addString(const QString &string);
+	};
+
+	explicit ContentBlockingCompiledProfile(const QByteArray &data);
+	~ContentBlockingCompiledProfile();
+
+	static ContentBlockingCompiledProfile* load(const QString &sourcePath, bool *isOutdated = NULL);
+	static QString getPath(const QString &sourcePath);
+	QString getStyleSheet() const;
+	static QByteArray compile(const QString &sourcePath);
+	static QByteArray compileRules(const QStringList &rules);
+	QString getStyleSheetBlackList(const QString &host) const;
+	QString getStyleSheetWhiteList(const QString &host) const;
+	MatchResult checkUrl(const QNetworkRequest &request, const QUrl &baseUrl) const;
+	void setMaskedLines(const QSet<quint32> &lines);
+	static bool save(const QByteArray &data, const QString &sourcePath);
+	bool isUrlBlocked(const QNetworkRequest &request, const QUrl &baseUrl) const;
+	bool isValid() const;
+
+protected:
+	struct RequestInformation
+	{
+		QString url;
+		QString baseHost;
+		QStringList subdomains;
+		QVector<quint32> baseHostDomains;
+		ContentBlockingProfile::RuleOptions options;
+		int hostPosition;
+	};
+
+	ContentBlockingCompiledProfile(QFile *file, uchar *data, qint64 size);
+
+	void initialize(const uchar *data, qint64 size);
+	static void parseRuleLine(QString line, CompilationData &compilationData);
+	static void parseStyleSheetRule(const QStringList &line, QHash<quint32, QStringList> &list, CompilationData &compilationData);
+	static void buildAutomaton(QVector<State> &states, const QVector<Edge> &edgesVector);
+	const Host* getHost(const QString &host) const;
+	QString getString(quint32 index) const;
+	static QByteArray createData(CompilationData &compilationData, const QString &sourcePath);
+	QString getStyleSheetList(const QString &host, bool isBlackList) const;
+	static quint32 getHash(const QString &string);
+	static quint32 getState(const Edge *edges, const State &state, ushort value);
+	bool resolveDomainExceptions(const QVector<quint32> &domains, quint32 offset, quint32 count) const;
+	bool resolveRuleOptions(const Rule &rule, const RequestInformation &information) const;
+	bool checkRuleMatch(const Rule &rule, const RequestInformation &information) const;
+	static bool matchPattern(const QString &pattern, const QString &url, int position, bool matchStart, bool matchEnd);
+	static bool isSeparator(const QChar &character);
+	static bool isSupportedSelector(const QString &selector);
+	static bool isHost(const QString &string);
+	bool isMasked(const Rule &rule) const;
+	bool isCurrent(const QString &sourcePath) const;
+
+private:
+	QFile *m_file;
+	uchar *m_mappedData;
+	QByteArray m_data;
+	QSet<quint32> m_maskedLines;
+	const Header *m_header;
+	const State *m_states;
+	const Edge *m_edges;
+	const Rule *m_rules;
+	const quint32 *m_domains;
+	const String *m_strings;
+	const Host *m_hosts;
+	const QChar *m_characters;
+
+	static const quint32 m_magic;
+	static const quint32 m_version;
+	static const quint32 m_invalidIndex;
+};
+
+}
+
+#endif
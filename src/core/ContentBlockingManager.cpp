@@ -24,6 +24,7 @@
 #include "SettingsManager.h"
 #include "SessionsManager.h"
 
+#include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 
 namespace Otter
@@ -31,6 +32,10 @@ namespace Otter
 
 ContentBlockingManager* ContentBlockingManager::m_instance = NULL;
 QVector<ContentBlockingProfile*> ContentBlockingManager::m_profiles;
+QCache<QString, bool> ContentBlockingManager::m_cache;
+QHash<QString, QByteArray> ContentBlockingManager::m_styleSheets;
+int ContentBlockingManager::m_cacheHits = 0;
+int ContentBlockingManager::m_cacheMisses = 0;
 
 ContentBlockingManager::ContentBlockingManager(QObject *parent) : QObject(parent)
 {
@@ -42,8 +47,26 @@ void ContentBlockingManager::createInstance(QObject *parent)
 	{
 		m_instance = new ContentBlockingManager(parent);
 
+		m_cache.setMaxCost(SettingsManager::getValue(QLatin1String("Content/BlockingCacheSize")).toInt());
+
 		loadProfiles();
+
+		connect(SettingsManager::getInstance(), SIGNAL(valueChanged(QString,QVariant)), m_instance, SLOT(optionChanged(QString,QVariant)));
+	}
+}
+
+void ContentBlockingManager::clearCache()
+{
+	if ((m_cacheHits + m_cacheMisses) > 0)
+	{
+		Console::addMessage(QCoreApplication::translate("main", "Content blocking cache cleared after %1 hits and %2 misses").arg(m_cacheHits).arg(m_cacheMisses), Otter::OtherMessageCategory, LogMessageLevel);
 	}
+
+	m_cache.clear();
+	m_styleSheets.clear();
+
+	m_cacheHits = 0;
+	m_cacheMisses = 0;
 }
 
 void ContentBlockingManager::loadProfiles()
@@ -73,10 +96,27 @@ void ContentBlockingManager::loadProfiles()
 
 	for (int i = 0; i < existingProfiles.count(); ++i)
 	{
-		m_profiles.append(new ContentBlockingProfile(existingProfiles.at(i).absoluteFilePath(), m_instance));
+		ContentBlockingProfile *profile = new ContentBlockingProfile(existingProfiles.at(i).absoluteFilePath(), m_instance);
+
+		m_profiles.append(profile);
+
+		connect(profile, SIGNAL(profileModified()), m_instance, SLOT(profileModified()));
 	}
 }
 
+void ContentBlockingManager::optionChanged(const QString &option, const QVariant &value)
+{
+	if (option == QLatin1String("Content/BlockingCacheSize"))
+	{
+		m_cache.setMaxCost(value.toInt());
+	}
+}
+
+void ContentBlockingManager::profileModified()
+{
+	clearCache();
+}
+
 ContentBlockingManager* ContentBlockingManager::getInstance()
 {
 	return m_instance;
@@ -84,7 +124,19 @@ ContentBlockingManager* ContentBlockingManager::getInstance()
 
 QByteArray ContentBlockingManager::getStyleSheet(const QVector<int> &profiles)
 {
-	QByteArray styleSheet;
+	QString key;
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		key += QString::number(profiles.at(i)) + QLatin1Char(',');
+	}
+
+	if (m_styleSheets.contains(key))
+	{
+		return m_styleSheets.value(key);
+	}
+
+	QString styleSheet;
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
@@ -94,7 +146,9 @@ QByteArray ContentBlockingManager::getStyleSheet(const QVector<int> &profiles)
 		}
 	}
 
-	return styleSheet;
+	m_styleSheets[key] = styleSheet.toUtf8();
+
+	return m_styleSheets[key];
 }
 
 QStringList ContentBlockingManager::createSubdomainList(const QString &domain)
@@ -128,30 +182,40 @@ QVector<ContentBlockingInformation> ContentBlockingManager::getProfiles()
 	return profiles;
 }
 
-QMultiHash<QString, QString> ContentBlockingManager::getStyleSheetBlackList(const QVector<int> &profiles)
+QString ContentBlockingManager::getStyleSheetBlackList(const QVector<int> &profiles, const QString &host)
 {
-	QMultiHash<QString, QString> blackList;
+	QString blackList;
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
 		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
 		{
-			blackList += m_profiles.at(profiles[i])->getStyleSheetWhiteList();
+			const QString selectors = m_profiles.at(profiles[i])->getStyleSheetBlackList(host);
+
+			if (!selectors.isEmpty())
+			{
+				blackList += (blackList.isEmpty() ? selectors : (QLatin1Char(',') + selectors));
+			}
 		}
 	}
 
 	return blackList;
 }
 
-QMultiHash<QString, QString> ContentBlockingManager::getStyleSheetWhiteList(const QVector<int> &profiles)
+QString ContentBlockingManager::getStyleSheetWhiteList(const QVector<int> &profiles, const QString &host)
 {
-	QMultiHash<QString, QString> whiteList;
+	QString whiteList;
 
 	for (int i = 0; i < profiles.count(); ++i)
 	{
 		if (profiles[i] >= 0 && profiles[i] < m_profiles.count())
 		{
-			whiteList += m_profiles.at(profiles[i])->getStyleSheetBlackList();
+			const QString selectors = m_profiles.at(profiles[i])->getStyleSheetWhiteList(host);
+
+			if (!selectors.isEmpty())
+			{
+				whiteList += (whiteList.isEmpty() ? selectors : (QLatin1Char(',') + selectors));
+			}
 		}
 	}
 
@@ -188,15 +252,41 @@ bool ContentBlockingManager::isUrlBlocked(const QVector<int> &profiles, const QN
 		return false;
 	}
 
+	QString key;
+
+	for (int i = 0; i < profiles.count(); ++i)
+	{
+		key += QString::number(profiles.at(i)) + QLatin1Char(',');
+	}
+
+	key += QLatin1Char(' ') + QString::number(static_cast<int>(ContentBlockingProfile::getRequestOptions(request))) + QLatin1Char(' ') + baseUrl.host() + QLatin1Char(' ') + request.url().toString(QUrl::RemoveFragment);
+
+	const bool *cachedResult = m_cache.object(key);
+
+	if (cachedResult)
+	{
+		++m_cacheHits;
+
+		return *cachedResult;
+	}
+
+	++m_cacheMisses;
+
+	bool isBlocked = false;
+
 	for (int i = 0; i < profiles.count(); ++i)
 	{
 		if (profiles[i] >= 0 && profiles[i] < m_profiles.count() && m_profiles.at(profiles[i])->isUrlBlocked(request, baseUrl))
 		{
-			return true;
+			isBlocked = true;
+
+			break;
 		}
 	}
 
-	return false;
+	m_cache.insert(key, new bool(isBlocked));
+
+	return isBlocked;
 }
 
 }
@@ -21,6 +21,7 @@
 #ifndef OTTER_CONTENTBLOCKINGMANAGER_H
 #define OTTER_CONTENTBLOCKINGMANAGER_H
 
+#include <QtCore/QCache>
 #include <QtCore/QObject>
 #include <QtNetwork/QNetworkRequest>
 
@@ -36,12 +37,13 @@ class ContentBlockingManager : public QObject
 
 public:
 	static void createInstance(QObject *parent = NULL);
+	static void clearCache();
 	static ContentBlockingManager* getInstance();
 	static QByteArray getStyleSheet(const QVector<int> &profiles);
 	static QStringList createSubdomainList(const QString &domain);
 	static QVector<ContentBlockingInformation> getProfiles();
-	static QMultiHash<QString, QString> getStyleSheetBlackList(const QVector<int> &profiles);
-	static QMultiHash<QString, QString> getStyleSheetWhiteList(const QVector<int> &profiles);
+	static QString getStyleSheetBlackList(const QVector<int> &profiles, const QString &host);
+	static QString getStyleSheetWhiteList(const QVector<int> &profiles, const QString &host);
 	static QVector<int> getProfileList(const QStringList &names);
 	static bool isUrlBlocked(const QVector<int> &profiles, const QNetworkRequest &request, const QUrl &baseUrl);
 
@@ -50,9 +52,17 @@ protected:
 
 	static void loadProfiles();
 
+protected slots:
+	void optionChanged(const QString &option, const QVariant &value);
+	void profileModified();
+
 private:
 	static ContentBlockingManager *m_instance;
 	static QVector<ContentBlockingProfile*> m_profiles;
+	static QCache<QString, bool> m_cache;
+	static QHash<QString, QByteArray> m_styleSheets;
+	static int m_cacheHits;
+	static int m_cacheMisses;
 };
 
 }
@@ -21,16 +21,17 @@
 
 #include "ContentBlockingProfile.h"
 #include "Console.h"
-#include "ContentBlockingManager.h"
+#include "ContentBlockingCompiledProfile.h"
 #include "NetworkManager.h"
 #include "NetworkManagerFactory.h"
 #include "SessionsManager.h"
 
-#include <QtConcurrent/QtConcurrentRun>
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
+#include <QtCore/QSaveFile>
 #include <QtCore/QSettings>
 #include <QtCore/QTextStream>
+#include <QtConcurrent/QtConcurrentRun>
 #include <QtNetwork/QNetworkReply>
 #include <QtNetwork/QNetworkRequest>
 
@@ -38,9 +39,13 @@ namespace Otter
 {
 
 ContentBlockingProfile::ContentBlockingProfile(const QString &path, QObject *parent) : QObject(parent),
-	m_root(NULL),
+	m_compiledProfile(NULL),
+	m_overlayProfile(NULL),
 	m_networkReply(NULL),
+	m_compilationWatcher(NULL),
 	m_updateRequested(false),
+	m_compilationRequested(false),
+	m_hasDifferences(false),
 	m_isEmpty(true),
 	m_wasLoaded(false)
 {
@@ -51,6 +56,12 @@ ContentBlockingProfile::ContentBlockingProfile(const QString &path, QObject *par
 	load(true);
 }
 
+ContentBlockingProfile::~ContentBlockingProfile()
+{
+	delete m_compiledProfile;
+	delete m_overlayProfile;
+}
+
 void ContentBlockingProfile::load(bool onlyHeader)
 {
 	QFile file(m_information.path);
@@ -118,612 +129,494 @@ void ContentBlockingProfile::load(bool onlyHeader)
 	}
 }
 
-void ContentBlockingProfile::parseRuleLine(QString line)
+void ContentBlockingProfile::downloadUpdate()
 {
-	if (line.indexOf(QLatin1Char('!')) == 0 || line.isEmpty())
+	if (m_updateRequested)
 	{
 		return;
 	}
 
-	if (line.startsWith(QLatin1String("##")))
+	if (!m_information.updateUrl.isValid())
 	{
-		m_styleSheet += line.mid(2) + QLatin1Char(',');
+		if (m_information.updateUrl.isEmpty())
+		{
+			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL is empty"), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+		}
+		else
+		{
+			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL (%1) is invalid").arg(m_information.updateUrl.toString()), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+		}
 
 		return;
 	}
 
-	if (line.contains(QLatin1String("##")))
-	{
-		parseStyleSheetRule(line.split(QLatin1String("##")), m_styleSheetBlackList);
+	QNetworkRequest request(m_information.updateUrl);
+	request.setHeader(QNetworkRequest::UserAgentHeader, NetworkManagerFactory::getUserAgent());
 
-		return;
-	}
+	m_networkReply = NetworkManagerFactory::getNetworkManager()->get(request);
 
-	if (line.contains(QLatin1String("#@#")))
-	{
-		parseStyleSheetRule(line.split(QLatin1String("#@#")), m_styleSheetWhiteList);
+	connect(m_networkReply, SIGNAL(finished()), this, SLOT(replyFinished()));
+
+	m_updateRequested = true;
+}
 
+void ContentBlockingProfile::replyFinished()
+{
+	if (!m_networkReply)
+	{
 		return;
 	}
 
-	const int optionSeparator = line.indexOf(QLatin1Char('$'));
-	QStringList options;
+	m_networkReply->deleteLater();
 
-	if (optionSeparator >= 0)
+	const QByteArray downloadedDataHeader = m_networkReply->readLine();
+	const QByteArray downloadedDataChecksum = m_networkReply->readLine();
+	const QByteArray downloadedData = m_networkReply->readAll();
+
+	if (m_networkReply->error() != QNetworkReply::NoError || !downloadedDataHeader.trimmed().startsWith(QByteArray("[Adblock Plus")))
 	{
-		options = line.mid(optionSeparator + 1).split(QLatin1Char(','), QString::SkipEmptyParts);
+		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(m_networkReply->errorString()), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
 
-		line = line.left(optionSeparator);
+		return;
 	}
 
-	while (line.endsWith(QLatin1Char('|')) || line.endsWith(QLatin1Char('*')) || line.endsWith(QLatin1Char('^')))
+	if (downloadedDataChecksum.contains(QByteArray("! Checksum: ")))
 	{
-		line = line.left(line.length() - 1);
-	}
+		QByteArray checksum = downloadedDataChecksum;
+		const QByteArray verifiedChecksum = QCryptographicHash::hash(downloadedDataHeader + QString(downloadedData).replace(QRegExp("^*\n{2,}"), QString("\n")).toStdString().c_str(), QCryptographicHash::Md5);
 
-	if (line.startsWith(QLatin1Char('*')))
-	{
-		line = line.mid(1);
+		if (verifiedChecksum.toBase64().replace(QByteArray("="), QByteArray()) != checksum.replace(QByteArray("! Checksum: "), QByteArray()).replace(QByteArray("\n"), QByteArray()))
+		{
+			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: checksum mismatch"), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+
+			return;
+		}
 	}
 
-	if (line.contains(QLatin1Char('*')) || line.contains(QLatin1Char('^')))
+	QStringList addedRules;
+	QSet<quint32> removedLines;
+	const bool canApplyDifferences = (m_wasLoaded && m_compiledProfile && !m_compilationWatcher && !m_hasDifferences && createDifferences(downloadedData, addedRules, removedLines));
+	QSaveFile file(m_information.path);
+
+	if (!file.open(QIODevice::WriteOnly))
 	{
-		// TODO
+		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file.errorString()), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+
 		return;
 	}
 
-	ContentBlockingRule *rule = new ContentBlockingRule();
-	rule->ruleOption = NoOption;
-	rule->exceptionRuleOption = NoOption;
-	rule->isException = false;
-	rule->needsDomainCheck = false;
+	file.write(downloadedDataHeader);
+	file.write(QStringLiteral("! URL: %1\n").arg(m_information.updateUrl.toString()).toUtf8());
+	file.write(downloadedDataChecksum);
+	file.write(downloadedData);
 
-	if (line.startsWith(QLatin1String("@@")))
+	if (!file.commit())
 	{
-		line = line.mid(2);
+		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file.errorString()), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
 
-		rule->isException = true;
+		return;
 	}
 
-	if (line.startsWith(QLatin1String("||")))
-	{
-		line = line.mid(2);
+	QSettings profilesSettings(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking.ini")), QSettings::IniFormat);
+	profilesSettings.setValue(m_information.name + QLatin1String("/lastUpdate"), QDateTime::currentDateTime().toString(Qt::ISODate));
 
-		rule->needsDomainCheck = true;
-	}
+	load(true);
 
-	for (int i = 0; i < options.count(); ++i)
+	if (canApplyDifferences && saveDifferences(addedRules, removedLines))
 	{
-		const bool optionException = options.at(i).startsWith(QLatin1Char('~'));
+		applyDifferences(addedRules, removedLines);
+	}
+	else if (m_wasLoaded)
+	{
+		compileRules();
+	}
+}
 
-		if (options.at(i).contains(QLatin1String("third-party")))
-		{
-			rule->ruleOption |= ThirdPartyOption;
-			rule->exceptionRuleOption |= (optionException ? ThirdPartyOption : NoOption);
-		}
-		else if (options.at(i).contains(QLatin1String("stylesheet")))
-		{
-			rule->ruleOption |= StyleSheetOption;
-			rule->exceptionRuleOption |= (optionException ? StyleSheetOption : NoOption);
-		}
-		else if (options.at(i).contains(QLatin1String("image")))
-		{
-			rule->ruleOption |= ImageOption;
-			rule->exceptionRuleOption |= (optionException ? ImageOption : NoOption);
-		}
-		else if (options.at(i).contains(QLatin1String("script")))
-		{
-			rule->ruleOption |= ScriptOption;
-			rule->exceptionRuleOption |= (optionException ? ScriptOption : NoOption);
-		}
-		else if (options.at(i).contains(QLatin1String("object")))
-		{
-			rule->ruleOption |= ObjectOption;
-			rule->exceptionRuleOption |= (optionException ? ObjectOption : NoOption);
-		}
-		else if (options.at(i).contains(QLatin1String("object-subrequest")) || options.at(i).contains(QLatin1String("object_subrequest")))
-		{
-			rule->ruleOption |= ObjectSubRequestOption;
-			rule->exceptionRuleOption |= (optionException ? ObjectSubRequestOption : NoOption);
-			// TODO
-			delete rule;
+void ContentBlockingProfile::compilationFinished()
+{
+	if (!m_compilationWatcher)
+	{
+		return;
+	}
 
-			return;
-		}
-		else if (options.at(i).contains(QLatin1String("subdocument")))
-		{
-			rule->ruleOption |= SubDocumentOption;
-			rule->exceptionRuleOption |= (optionException ? SubDocumentOption : NoOption);
-			// TODO
-			delete rule;
+	const QByteArray data = m_compilationWatcher->result();
 
-			return;
-		}
-		else if (options.at(i).contains(QLatin1String("xmlhttprequest")))
-		{
-			rule->ruleOption |= XmlHttpRequestOption;
-			rule->exceptionRuleOption |= (optionException ? XmlHttpRequestOption : NoOption);
-		}
-		else if (options.at(i).contains(QLatin1String("domain")))
-		{
-			const QStringList parsedDomains = options.at(i).mid(options.at(i).indexOf(QLatin1Char('=')) + 1).split(QLatin1Char('|'), QString::SkipEmptyParts);
+	m_compilationWatcher->deleteLater();
+	m_compilationWatcher = NULL;
 
-			for (int j = 0; j < parsedDomains.count(); ++j)
-			{
-				if (parsedDomains.at(j).startsWith(QLatin1Char('~')))
-				{
-					rule->allowedDomains.append(parsedDomains.at(j).mid(1));
+	setCompiledProfile(data);
 
-					continue;
-				}
+	emit profileModified();
+	emit updateCustomStyleSheets();
 
-				rule->blockedDomains.append(parsedDomains.at(j));
-			}
-		}
-		else
-		{
-			// TODO - document, elemhide
-			delete rule;
+	if (m_compilationRequested)
+	{
+		m_compilationRequested = false;
 
-			return;
-		}
+		compileRules();
 	}
-
-	addRule(rule, line);
-
-	return;
 }
 
-void ContentBlockingProfile::parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list)
+QString ContentBlockingProfile::getStyleSheet()
 {
-	const QStringList domains = line.at(0).split(QLatin1Char(','));
-
-	for (int i = 0; i < domains.count(); ++i)
+	if (!m_wasLoaded)
 	{
-		list.insert(domains.at(i), line.at(1));
+		loadRules();
 	}
+
+	return (m_compiledProfile ? m_compiledProfile->getStyleSheet() : QString());
 }
 
-void ContentBlockingProfile::resolveRuleOptions(ContentBlockingRule *rule, const QNetworkRequest &request, bool &isBlocked)
+ContentBlockingInformation ContentBlockingProfile::getInformation() const
 {
-	const QString url = request.url().url();
-	const QByteArray requestHeader = request.rawHeader(QByteArray("Accept"));
-	const QString baseUrlHost = m_baseUrl.host();
-
-	isBlocked = ((rule->allowedDomains.count() > 0) ? !resolveDomainExceptions(baseUrlHost, rule->allowedDomains) : isBlocked);
-	isBlocked = ((rule->blockedDomains.count() > 0) ? resolveDomainExceptions(baseUrlHost, rule->blockedDomains) : isBlocked);
+	return m_information;
+}
 
-	if (rule->ruleOption & ThirdPartyOption)
+QString ContentBlockingProfile::getStyleSheetBlackList(const QString &host)
+{
+	if (!m_wasLoaded)
 	{
-		if (baseUrlHost.isEmpty() || m_requestSubdomainList.contains(baseUrlHost))
-		{
-			isBlocked = (rule->exceptionRuleOption & ThirdPartyOption);
-		}
-		else
-		{
-			isBlocked = !(rule->exceptionRuleOption & ThirdPartyOption);
-		}
+		loadRules();
 	}
 
-	if (rule->ruleOption & ImageOption)
-	{
-		if (requestHeader.contains(QByteArray("image/")) || url.endsWith(QLatin1String(".png")) || url.endsWith(QLatin1String(".jpg")) || url.endsWith(QLatin1String(".gif")))
-		{
-			isBlocked = (isBlocked ? !(rule->exceptionRuleOption & ImageOption) : isBlocked);
-		}
-		else
-		{
-			isBlocked = (isBlocked ? (rule->exceptionRuleOption & ImageOption) : isBlocked);
-		}
-	}
+	return (m_compiledProfile ? m_compiledProfile->getStyleSheetBlackList(host) : QString());
+}
 
-	if (rule->ruleOption & ScriptOption)
+QString ContentBlockingProfile::getStyleSheetWhiteList(const QString &host)
+{
+	if (!m_wasLoaded)
 	{
-		if (requestHeader.contains(QByteArray("script/")) || url.endsWith(QLatin1String(".js")))
-		{
-			isBlocked = (isBlocked ? !(rule->exceptionRuleOption & ScriptOption) : isBlocked);
-		}
-		else
-		{
-			isBlocked = (isBlocked ? (rule->exceptionRuleOption & ScriptOption) : isBlocked);
-		}
+		loadRules();
 	}
 
-	if (rule->ruleOption & StyleSheetOption)
+	return (m_compiledProfile ? m_compiledProfile->getStyleSheetWhiteList(host) : QString());
+}
+
+ContentBlockingProfile::RuleOptions ContentBlockingProfile::getRequestOptions(const QNetworkRequest &request)
+{
+	const QString path = request.url().path();
+	const QByteArray acceptHeader = request.rawHeader(QByteArray("Accept"));
+	RuleOptions options = NoOption;
+
+	if (acceptHeader.contains(QByteArray("image/")) || path.endsWith(QLatin1String(".png")) || path.endsWith(QLatin1String(".jpg")) || path.endsWith(QLatin1String(".gif")))
 	{
-		if (requestHeader.contains(QByteArray("text/css")) || url.endsWith(QLatin1String(".css")))
-		{
-			isBlocked = (isBlocked ? !(rule->exceptionRuleOption & StyleSheetOption) : isBlocked);
-		}
-		else
-		{
-			isBlocked = (isBlocked ? (rule->exceptionRuleOption & StyleSheetOption) : isBlocked);
-		}
+		options |= ImageOption;
 	}
 
-	if (rule->ruleOption & ObjectOption)
+	if (acceptHeader.contains(QByteArray("script/")) || path.endsWith(QLatin1String(".js")))
 	{
-		if (requestHeader.contains(QByteArray("object")))
-		{
-			isBlocked = (isBlocked ? !(rule->exceptionRuleOption & ObjectOption) : isBlocked);
-		}
-		else
-		{
-			isBlocked = (isBlocked ? (rule->exceptionRuleOption & ObjectOption) : isBlocked);
-		}
+		options |= ScriptOption;
 	}
 
-	if (rule->ruleOption & SubDocumentOption)
+	if (acceptHeader.contains(QByteArray("text/css")) || path.endsWith(QLatin1String(".css")))
 	{
-		// TODO
+		options |= StyleSheetOption;
 	}
 
-	if (rule->ruleOption & ObjectSubRequestOption)
+	if (acceptHeader.contains(QByteArray("object")))
 	{
-		// TODO
+		options |= ObjectOption;
 	}
 
-	if (rule->ruleOption & XmlHttpRequestOption)
+	if (request.rawHeader(QByteArray("X-Requested-With")) == QByteArray("XMLHttpRequest"))
 	{
-		if (request.rawHeader(QByteArray("X-Requested-With")) == QByteArray("XMLHttpRequest"))
-		{
-			isBlocked = (isBlocked ? !(rule->exceptionRuleOption & XmlHttpRequestOption) : isBlocked);
-		}
-		else
-		{
-			isBlocked = (isBlocked ? (rule->exceptionRuleOption & XmlHttpRequestOption) : isBlocked);
-		}
+		options |= XmlHttpRequestOption;
 	}
+
+	return options;
 }
 
-void ContentBlockingProfile::addRule(ContentBlockingRule *rule, const QString &ruleString)
+bool ContentBlockingProfile::loadRules()
 {
-	Node *node = m_root;
-
-	for (int i = 0; i < ruleString.length(); ++i)
+	if (m_isEmpty)
 	{
-		const QChar value = ruleString.at(i);
-		bool childrenExists = false;
-
-		for (int j = 0; j < node->children.count(); ++j)
-		{
-			Node *nextNode = node->children.at(j);
-
-			if (nextNode->value == value)
-			{
-				node = nextNode;
-
-				childrenExists = true;
-
-				break;
-			}
-		}
-
-		if (!childrenExists)
-		{
-			Node *newNode = new Node;
-			newNode->value = value;
-
-			node->children.append(newNode);
+		downloadUpdate();
 
-			node = newNode;
-		}
+		return false;
 	}
 
-	node->rule = rule;
-}
+	bool isOutdated = false;
 
-void ContentBlockingProfile::deleteNode(Node *node)
-{
-	for (int j = 0; j < node->children.count(); ++j)
+	m_wasLoaded = true;
+	m_compiledProfile = ContentBlockingCompiledProfile::load(m_information.path, &isOutdated);
+
+// without any compiled profile requests would pass unchecked, so only outdated one is replaced in background
+	if (!m_compiledProfile)
 	{
-		deleteNode(node->children.at(j));
+		setCompiledProfile(ContentBlockingCompiledProfile::compile(m_information.path));
 	}
 
-	delete node->rule;
-	delete node;
-}
+	emit profileModified();
+	emit updateCustomStyleSheets();
 
-void ContentBlockingProfile::downloadUpdate()
-{
-	if (m_updateRequested)
+	if (isOutdated)
 	{
-		return;
-	}
+		QStringList addedRules;
+		QSet<quint32> removedLines;
 
-	if (!m_information.updateUrl.isValid())
-	{
-		if (m_information.updateUrl.isEmpty())
+// differences saved with last update are still valid for outdated profile, as it is replaced together with them
+		if (loadDifferences(addedRules, removedLines))
 		{
-			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL is empty"), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+			applyDifferences(addedRules, removedLines);
 		}
 		else
 		{
-			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile, update URL (%1) is invalid").arg(m_information.updateUrl.toString()), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+			compileRules();
 		}
-
-		return;
 	}
 
-	QNetworkRequest request(m_information.updateUrl);
-	request.setHeader(QNetworkRequest::UserAgentHeader, NetworkManagerFactory::getUserAgent());
-
-	m_networkReply = NetworkManagerFactory::getNetworkManager()->get(request);
-
-	connect(m_networkReply, SIGNAL(finished()), this, SLOT(replyFinished()));
-
-	m_updateRequested = true;
+	return true;
 }
 
-void ContentBlockingProfile::replyFinished()
+void ContentBlockingProfile::compileRules()
 {
-	if (!m_networkReply)
+	if (m_compilationWatcher)
 	{
+		m_compilationRequested = true;
+
 		return;
 	}
 
-	m_networkReply->deleteLater();
+	m_compilationWatcher = new QFutureWatcher<QByteArray>(this);
 
-	const QByteArray downloadedDataHeader = m_networkReply->readLine();
-	const QByteArray downloadedDataChecksum = m_networkReply->readLine();
-	const QByteArray downloadedData = m_networkReply->readAll();
-
-	if (m_networkReply->error() != QNetworkReply::NoError || !downloadedDataHeader.trimmed().startsWith(QByteArray("[Adblock Plus")))
-	{
-		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(m_networkReply->errorString()), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+	connect(m_compilationWatcher, SIGNAL(finished()), this, SLOT(compilationFinished()));
 
-		return;
-	}
+	m_compilationWatcher->setFuture(QtConcurrent::run(&ContentBlockingCompiledProfile::compile, m_information.path));
+}
 
-	if (downloadedDataChecksum.contains(QByteArray("! Checksum: ")))
-	{
-		QByteArray checksum = downloadedDataChecksum;
-		const QByteArray verifiedChecksum = QCryptographicHash::hash(downloadedDataHeader + QString(downloadedData).replace(QRegExp("^*\n{2,}"), QString("\n")).toStdString().c_str(), QCryptographicHash::Md5);
+void ContentBlockingProfile::setCompiledProfile(const QByteArray &data)
+{
+// mapped file cannot be replaced on Windows, so it needs to be released before saving
+	delete m_compiledProfile;
+	delete m_overlayProfile;
 
-		if (verifiedChecksum.toBase64().replace(QByteArray("="), QByteArray()) != checksum.replace(QByteArray("! Checksum: "), QByteArray()).replace(QByteArray("\n"), QByteArray()))
-		{
-			Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: checksum mismatch"), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+	m_compiledProfile = NULL;
+	m_overlayProfile = NULL;
+	m_hasDifferences = false;
 
-			return;
-		}
-	}
+	QFile::remove(getDifferencesPath());
 
-	QFile file(m_information.path);
+	ContentBlockingCompiledProfile *compiledProfile = (ContentBlockingCompiledProfile::save(data, m_information.path) ? ContentBlockingCompiledProfile::load(m_information.path) : NULL);
 
-	if (!file.open(QFile::ReadWrite | QFile::Truncate))
+	if (!compiledProfile)
 	{
-		Console::addMessage(QCoreApplication::translate("main", "Failed to update content blocking profile: %1").arg(file.errorString()), Otter::OtherMessageCategory, ErrorMessageLevel, m_information.path);
+		Console::addMessage(QCoreApplication::translate("main", "Failed to save compiled content blocking profile"), Otter::OtherMessageCategory, WarningMessageLevel, m_information.path);
 
-		return;
+		compiledProfile = new ContentBlockingCompiledProfile(data);
 	}
 
-	QSettings profilesSettings(SessionsManager::getWritableDataPath(QLatin1String("contentBlocking.ini")), QSettings::IniFormat);
-	profilesSettings.setValue(m_information.name + QLatin1String("/lastUpdate"), QDateTime::currentDateTime().toString(Qt::ISODate));
+	m_compiledProfile = compiledProfile;
+}
 
-	file.write(downloadedDataHeader);
-	file.write(QStringLiteral("! URL: %1\n").arg(m_information.updateUrl.toString()).toUtf8());
-	file.write(downloadedDataChecksum);
-	file.write(downloadedData);
-	file.close();
+void ContentBlockingProfile::applyDifferences(const QStringList &addedRules, const QSet<quint32> &removedLines)
+{
+	m_hasDifferences = true;
 
-	if (file.error() != QFile::NoError)
+	if (addedRules.isEmpty() && removedLines.isEmpty())
 	{
-// TODO
+		return;
 	}
 
-	if (m_wasLoaded)
-	{
-		if (m_root)
-		{
-			QtConcurrent::run(this, &ContentBlockingProfile::deleteNode, m_root);
-		}
+	m_compiledProfile->setMaskedLines(removedLines);
 
-		m_styleSheet.clear();
-		m_styleSheetWhiteList.clear();
-		m_styleSheetBlackList.clear();
+	if (!addedRules.isEmpty())
+	{
+		m_overlayProfile = new ContentBlockingCompiledProfile(ContentBlockingCompiledProfile::compileRules(addedRules));
 	}
 
-	load(!m_wasLoaded);
+	emit profileModified();
 }
 
-QString ContentBlockingProfile::getStyleSheet()
+QString ContentBlockingProfile::getDifferencesPath() const
 {
-	if (!m_wasLoaded)
-	{
-		loadRules();
-	}
+	const QFileInfo information(m_information.path);
 
-	return m_styleSheet;
+	return information.absoluteDir().filePath(information.baseName() + QLatin1String(".diff"));
 }
 
-ContentBlockingInformation ContentBlockingProfile::getInformation() const
+bool ContentBlockingProfile::loadDifferences(QStringList &addedRules, QSet<quint32> &removedLines) const
 {
-	return m_information;
-}
+	QFile file(getDifferencesPath());
 
-QMultiHash<QString, QString> ContentBlockingProfile::getStyleSheetWhiteList()
-{
-	if (!m_wasLoaded)
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
 	{
-		loadRules();
+		return false;
 	}
 
-	return m_styleSheetBlackList;
-}
+	const QFileInfo information(m_information.path);
+	QTextStream stream(&file);
+	const QStringList source = stream.readLine().split(QLatin1Char(' '));
 
-QMultiHash<QString, QString> ContentBlockingProfile::getStyleSheetBlackList()
-{
-	if (!m_wasLoaded)
+	if (source.count() != 2 || source.at(0).toLongLong() != information.size() || source.at(1).toLongLong() != information.lastModified().toMSecsSinceEpoch())
 	{
-		loadRules();
+		file.close();
+
+		return false;
 	}
 
-	return m_styleSheetWhiteList;
-}
+	const QStringList lines = stream.readLine().split(QLatin1Char(' '), QString::SkipEmptyParts);
 
-bool ContentBlockingProfile::loadRules()
-{
-	if (m_isEmpty)
+	for (int i = 0; i < lines.count(); ++i)
 	{
-		downloadUpdate();
-
-		return false;
+		removedLines.insert(lines.at(i).toUInt());
 	}
 
-	m_wasLoaded = true;
-
-	if (m_domainExpression.pattern().isEmpty())
+	while (!stream.atEnd())
 	{
-		m_domainExpression = QRegularExpression(QLatin1String("[:\?&/=]"));
-#if QT_VERSION >= 0x050400
-		m_domainExpression.optimize();
-#endif
+		addedRules.append(stream.readLine());
 	}
 
-	QFile file(m_information.path);
+	file.close();
 
-	file.open(QIODevice::ReadOnly | QIODevice::Text);
+	return true;
+}
 
-	QTextStream stream(&file);
+bool ContentBlockingProfile::saveDifferences(const QStringList &addedRules, const QSet<quint32> &removedLines) const
+{
+	QSaveFile file(getDifferencesPath());
 
-	stream.readLine(); // header
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+	{
+		return false;
+	}
 
-	m_root = new Node();
+	const QFileInfo information(m_information.path);
+	QStringList lines;
+	QSet<quint32>::const_iterator iterator;
 
-	while (!stream.atEnd())
+	for (iterator = removedLines.constBegin(); iterator != removedLines.constEnd(); ++iterator)
 	{
-		parseRuleLine(stream.readLine());
+		lines.append(QString::number(*iterator));
 	}
 
-	file.close();
+	QTextStream stream(&file);
+	stream << information.size() << QLatin1Char(' ') << information.lastModified().toMSecsSinceEpoch() << QLatin1Char('\n');
+	stream << lines.join(QLatin1Char(' ')) << QLatin1Char('\n');
 
-	if (m_styleSheet.length() > 0)
+	for (int i = 0; i < addedRules.count(); ++i)
 	{
-		m_styleSheet = m_styleSheet.left(m_styleSheet.length() - 1);
-		m_styleSheet += QLatin1String("{display:none;}");
+		stream << addedRules.at(i) << QLatin1Char('\n');
 	}
 
-	emit updateCustomStyleSheets();
+	stream.flush();
 
-	return true;
+	return file.commit();
 }
 
-bool ContentBlockingProfile::resolveDomainExceptions(const QString &url, const QStringList &ruleList)
+bool ContentBlockingProfile::isUrlBlocked(const QNetworkRequest &request, const QUrl &baseUrl)
 {
-	for (int i = 0; i < ruleList.count(); ++i)
+	if (!m_wasLoaded)
 	{
-		if (url.contains(ruleList.at(i)))
+		if (!loadRules())
 		{
-			return true;
+			return false;
 		}
 	}
 
-	return false;
-}
+	if (!m_compiledProfile)
+	{
+		return false;
+	}
 
-bool ContentBlockingProfile::checkUrlSubstring(const QString &subString, const QNetworkRequest &request)
-{
-	Node *node = m_root;
-	m_currentRule.clear();
+	const ContentBlockingCompiledProfile::MatchResult result = m_compiledProfile->checkUrl(request, baseUrl);
 
-	for (int i = 0; i < subString.length(); ++i)
+	if (!m_overlayProfile || result == ContentBlockingCompiledProfile::ExceptionMatchResult)
 	{
-		const QChar treeChar = subString.at(i);
+		return (result == ContentBlockingCompiledProfile::BlockMatchResult);
+	}
 
-		if (node->rule && checkRuleMatch(node->rule, request))
-		{
-			return true;
-		}
+	const ContentBlockingCompiledProfile::MatchResult overlayResult = m_overlayProfile->checkUrl(request, baseUrl);
 
-		bool childrenExists = false;
+	return (overlayResult == ContentBlockingCompiledProfile::BlockMatchResult || (overlayResult == ContentBlockingCompiledProfile::NoMatchResult && result == ContentBlockingCompiledProfile::BlockMatchResult));
+}
 
-		for (int j = 0; j < node->children.count(); ++j)
-		{
-			Node *nextNode = node->children.at(j);
+bool ContentBlockingProfile::createDifferences(const QByteArray &data, QStringList &addedRules, QSet<quint32> &removedLines) const
+{
+	QFile file(m_information.path);
 
-			if (nextNode->value == treeChar)
-			{
-				node = nextNode;
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		return false;
+	}
 
-				childrenExists = true;
+	QMultiHash<quint64, quint32> currentRules;
+	QSet<quint64> styleSheetRules;
+	QTextStream currentStream(&file);
+	quint32 line = 0;
 
-				break;
-			}
-		}
+	currentStream.readLine(); // header
+
+	while (!currentStream.atEnd())
+	{
+		++line;
+
+		const QString rule = currentStream.readLine();
 
-		if (!childrenExists)
+		if (!rule.isEmpty() && !rule.startsWith(QLatin1Char('!')))
 		{
-			return false;
-		}
+			const quint64 hash = getRuleHash(rule);
 
-		m_currentRule += treeChar;
-	}
+			currentRules.insert(hash, line);
 
-	if (node->rule && checkRuleMatch(node->rule, request))
-	{
-		return true;
+			if (rule.contains(QLatin1String("##")) || rule.contains(QLatin1String("#@#")))
+			{
+				styleSheetRules.insert(hash);
+			}
+		}
 	}
 
-	return false;
-}
+	file.close();
 
-bool ContentBlockingProfile::checkRuleMatch(ContentBlockingRule *rule, const QNetworkRequest &request)
-{
-	bool isBlocked = false;
+	QTextStream stream(data);
 
-	if (request.url().url().contains(m_currentRule))
+	while (!stream.atEnd())
 	{
-		m_requestSubdomainList = ContentBlockingManager::createSubdomainList(request.url().host());
+		const QString rule = stream.readLine();
 
-		if (rule->needsDomainCheck)
+		if (rule.isEmpty() || rule.startsWith(QLatin1Char('!')) || currentRules.remove(getRuleHash(rule)) > 0)
 		{
-			if (!m_requestSubdomainList.contains(m_currentRule.left(m_currentRule.indexOf(m_domainExpression))))
-			{
-				return false;
-			}
-			else
-			{
-				isBlocked = true;
-			}
+			continue;
 		}
 
-		if (isBlocked)
+		if (rule.contains(QLatin1String("##")) || rule.contains(QLatin1String("#@#")))
 		{
-			isBlocked = !rule->isException;
+			return false;
 		}
 
-		resolveRuleOptions(rule, request, isBlocked);
+		addedRules.append(rule);
+
+		if (addedRules.count() > 1000)
+		{
+			return false;
+		}
 	}
 
-	return isBlocked;
-}
+	QMultiHash<quint64, quint32>::const_iterator iterator;
 
-bool ContentBlockingProfile::isUrlBlocked(const QNetworkRequest &request, const QUrl &baseUrl)
-{
-	if (!m_wasLoaded)
+	for (iterator = currentRules.constBegin(); iterator != currentRules.constEnd(); ++iterator)
 	{
-		if (!loadRules())
+		if (styleSheetRules.contains(iterator.key()))
 		{
 			return false;
 		}
+
+		removedLines.insert(iterator.value());
 	}
 
-	const QString url = request.url().url();
-	const int urlLenght = url.length();
+	return ((addedRules.count() + removedLines.count()) <= 1000);
+}
 
-	m_baseUrl = baseUrl;
+quint64 ContentBlockingProfile::getRuleHash(const QString &rule)
+{
+	quint64 hash = Q_UINT64_C(14695981039346656037);
 
-	for (int i = 0; i < urlLenght; ++i)
+	for (int i = 0; i < rule.length(); ++i)
 	{
-		const QString testString = url.right(urlLenght - i);
-
-		if (checkUrlSubstring(testString, request))
-		{
-			return true;
-		}
+		hash ^= rule.at(i).unicode();
+		hash *= Q_UINT64_C(1099511628211);
 	}
 
-	return false;
+	return hash;
 }
 
 }
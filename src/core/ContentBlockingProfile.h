@@ -22,14 +22,17 @@
 #ifndef OTTER_CONTENTBLOCKINGPROFILE_H
 #define OTTER_CONTENTBLOCKINGPROFILE_H
 
+#include <QtCore/QFutureWatcher>
 #include <QtCore/QObject>
-#include <QtCore/QRegularExpression>
+#include <QtCore/QSet>
 #include <QtCore/QUrl>
 #include <QtNetwork/QNetworkReply>
 
 namespace Otter
 {
 
+class ContentBlockingCompiledProfile;
+
 struct ContentBlockingInformation
 {
 	QString name;
@@ -58,65 +61,47 @@ public:
 
 	Q_DECLARE_FLAGS(RuleOptions, RuleOption)
 
-	struct ContentBlockingRule
-	{
-		QStringList blockedDomains;
-		QStringList allowedDomains;
-		RuleOptions ruleOption;
-		RuleOptions exceptionRuleOption;
-		bool isException;
-		bool needsDomainCheck;
-	};
-
 	explicit ContentBlockingProfile(const QString &path, QObject *parent = NULL);
+	~ContentBlockingProfile();
 
 	QString getStyleSheet();
 	ContentBlockingInformation getInformation() const;
-	QMultiHash<QString, QString> getStyleSheetWhiteList();
-	QMultiHash<QString, QString> getStyleSheetBlackList();
+	QString getStyleSheetBlackList(const QString &host);
+	QString getStyleSheetWhiteList(const QString &host);
+	static RuleOptions getRequestOptions(const QNetworkRequest &request);
 	bool isUrlBlocked(const QNetworkRequest &request, const QUrl &baseUrl);
 
 protected:
-	struct Node
-	{
-		QChar value;
-		ContentBlockingRule *rule;
-		QVarLengthArray<Node*, 5> children;
-
-		Node() : value(0), rule(NULL) {}
-	};
-
 	void load(bool onlyHeader = false);
-	void parseRuleLine(QString line);
-	void resolveRuleOptions(ContentBlockingRule *rule, const QNetworkRequest &request, bool &isBlocked);
-	void parseStyleSheetRule(const QStringList &line, QMultiHash<QString, QString> &list);
-	void addRule(ContentBlockingRule *rule, const QString &ruleString);
-	void deleteNode(Node *node);
 	void downloadUpdate();
 	bool loadRules();
-	bool resolveDomainExceptions(const QString &url, const QStringList &ruleList);
-	bool checkUrlSubstring(const QString &subString, const QNetworkRequest &request);
-	bool checkRuleMatch(ContentBlockingRule *rule, const QNetworkRequest &request);
+	void compileRules();
+	void setCompiledProfile(const QByteArray &data);
+	void applyDifferences(const QStringList &addedRules, const QSet<quint32> &removedLines);
+	QString getDifferencesPath() const;
+	static quint64 getRuleHash(const QString &rule);
+	bool createDifferences(const QByteArray &data, QStringList &addedRules, QSet<quint32> &removedLines) const;
+	bool loadDifferences(QStringList &addedRules, QSet<quint32> &removedLines) const;
+	bool saveDifferences(const QStringList &addedRules, const QSet<quint32> &removedLines) const;
 
 private slots:
 	void replyFinished();
+	void compilationFinished();
 
 private:
-	Node *m_root;
+	ContentBlockingCompiledProfile *m_compiledProfile;
+	ContentBlockingCompiledProfile *m_overlayProfile;
 	QNetworkReply *m_networkReply;
-	QString m_styleSheet;
-	QString m_currentRule;
-	QUrl m_baseUrl;
-	QRegularExpression m_domainExpression;
+	QFutureWatcher<QByteArray> *m_compilationWatcher;
 	ContentBlockingInformation m_information;
-	QStringList m_requestSubdomainList;
-	QMultiHash<QString, QString> m_styleSheetBlackList;
-	QMultiHash<QString, QString> m_styleSheetWhiteList;
 	bool m_updateRequested;
+	bool m_compilationRequested;
+	bool m_hasDifferences;
 	bool m_isEmpty;
 	bool m_wasLoaded;
 
 signals:
+	void profileModified();
 	void updateCustomStyleSheets();
 };
 
@@ -22,17 +22,24 @@
 #include "SettingsManager.h"
 
 #include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
 #include <QtCore/QFile>
 #include <QtCore/QSaveFile>
 #include <QtCore/QTimerEvent>
+#include <QtConcurrent/QtConcurrentRun>
 
 namespace Otter
 {
 
+const quint32 CookieJar::m_snapshotMagic = 0x4f434a31;
+
 CookieJar::CookieJar(bool isPrivate, QObject *parent) : QNetworkCookieJar(parent),
+	m_compactionWatcher(NULL),
 	m_generalCookiesPolicy(AcceptAllCookies),
 	m_thirdPartyCookiesPolicy(AcceptAllCookies),
 	m_keepMode(KeepUntilExpiresMode),
+	m_journalSize(0),
+	m_snapshotSize(0),
 	m_saveTimer(0),
 	m_isPrivate(isPrivate)
 {
@@ -41,44 +48,93 @@ CookieJar::CookieJar(bool isPrivate, QObject *parent) : QNetworkCookieJar(parent
 		return;
 	}
 
+	const QString path = SessionsManager::getWritableDataPath(QLatin1String("cookies.log"));
 	QFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")));
+	bool needsCompaction = false;
 
-	if (!file.open(QIODevice::ReadOnly))
+	if (file.open(QIODevice::ReadOnly))
 	{
-		return;
-	}
+		QList<QNetworkCookie> allCookies;
+		QDataStream stream(&file);
+		quint32 magic;
 
-	QList<QNetworkCookie> allCookies;
-	QDataStream stream(&file);
-	quint32 amount;
+		stream >> magic;
 
-	stream >> amount;
+		if (magic == m_snapshotMagic)
+		{
+			quint32 amount;
 
-	for (quint32 i = 0; i < amount; ++i)
-	{
-		QByteArray value;
+			stream >> amount;
 
-		stream >> value;
+			for (quint32 i = 0; i < amount; ++i)
+			{
+				CookieOperation operation;
+				QNetworkCookie cookie;
 
-		const QList<QNetworkCookie> cookies = QNetworkCookie::parseCookies(value);
+				if (!readCookie(stream, operation, cookie))
+				{
+					break;
+				}
 
-		for (int j = 0; j < cookies.count(); ++j)
-		{
-			allCookies.append(cookies.at(j));
+				allCookies.append(cookie);
+			}
 		}
-
-		if (stream.atEnd())
+		else
 		{
-			break;
+			for (quint32 i = 0; i < magic; ++i)
+			{
+				QByteArray value;
+
+				stream >> value;
+
+				const QList<QNetworkCookie> cookies = QNetworkCookie::parseCookies(value);
+
+				for (int j = 0; j < cookies.count(); ++j)
+				{
+					allCookies.append(cookies.at(j));
+				}
+
+				if (stream.atEnd())
+				{
+					break;
+				}
+			}
+
+			needsCompaction = true;
 		}
+
+		m_snapshotSize = file.size();
+
+		file.close();
+
+		setCookies(allCookies);
 	}
 
+	loadJournal(path + QLatin1String(".old"));
+	loadJournal(path);
+
 	optionChanged(QLatin1String("Network/CookiesPolicy"), SettingsManager::getValue(QLatin1String("Network/CookiesPolicy")));
-	setAllCookies(allCookies);
+
+	if (needsCompaction)
+	{
+		compact();
+	}
 
 	connect(SettingsManager::getInstance(), SIGNAL(valueChanged(QString,QVariant)), this, SLOT(optionChanged(QString,QVariant)));
 }
 
+CookieJar::~CookieJar()
+{
+	if (m_compactionWatcher)
+	{
+		m_compactionWatcher->waitForFinished();
+
+		compactionFinished();
+	}
+
+	save();
+}
+
 void CookieJar::timerEvent(QTimerEvent *event)
 {
 	if (event->timerId() != m_saveTimer)
@@ -91,6 +147,11 @@ void CookieJar::timerEvent(QTimerEvent *event)
 	m_saveTimer = 0;
 
 	save();
+
+	if (m_journalSize > qMax(qint64(65536), m_snapshotSize))
+	{
+		compact();
+	}
 }
 
 void CookieJar::optionChanged(const QString &option, const QVariant &value)
@@ -124,16 +185,41 @@ void CookieJar::clearCookies(int period)
 {
 	Q_UNUSED(period)
 
-	const QList<QNetworkCookie> cookies = allCookies();
+	const QList<QNetworkCookie> cookies = getCookies();
+
+	m_cookies.clear();
+	m_journal.clear();
 
 	for (int i = 0; i < cookies.length(); ++i)
 	{
-		QNetworkCookieJar::deleteCookie(cookies.at(i));
-
 		emit cookieRemoved(cookies.at(i));
 	}
 
-	save();
+	if (m_compactionWatcher)
+	{
+		m_compactionWatcher->waitForFinished();
+
+		compactionFinished();
+	}
+
+	if (m_isPrivate)
+	{
+		return;
+	}
+
+// cleared cookies must not come back from snapshot or journals even if browser is killed right after clearing them
+	const QString path = SessionsManager::getWritableDataPath(QLatin1String("cookies.log"));
+	const qint64 size = saveCookies(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")), QList<QNetworkCookie>());
+
+	if (size >= 0)
+	{
+		m_snapshotSize = size;
+	}
+
+	QFile::remove(path);
+	QFile::remove(path + QLatin1String(".old"));
+
+	m_journalSize = 0;
 }
 
 void CookieJar::scheduleSave()
@@ -146,32 +232,272 @@ void CookieJar::scheduleSave()
 
 void CookieJar::save()
 {
-	QSaveFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")));
+	if (m_isPrivate || m_journal.isEmpty())
+	{
+		return;
+	}
 
-	if (!file.open(QIODevice::WriteOnly))
+	QFile file(SessionsManager::getWritableDataPath(QLatin1String("cookies.log")));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
 	{
 		return;
 	}
 
-	const QList<QNetworkCookie> cookies = allCookies();
 	QDataStream stream(&file);
-	stream << quint32(cookies.length());
+
+	for (int i = 0; i < m_journal.count(); ++i)
+	{
+		writeCookie(stream, m_journal.at(i).first, m_journal.at(i).second);
+	}
+
+	m_journal.clear();
+	m_journalSize = file.size();
+
+	file.close();
+}
+
+void CookieJar::compact()
+{
+	if (m_isPrivate || m_compactionWatcher)
+	{
+		return;
+	}
+
+	save();
+
+	const QString path = SessionsManager::getWritableDataPath(QLatin1String("cookies.log"));
+	const QString oldPath = path + QLatin1String(".old");
+
+	if (QFile::exists(oldPath))
+	{
+		QFile oldFile(oldPath);
+		QFile file(path);
+
+		if (file.open(QIODevice::ReadOnly) && oldFile.open(QIODevice::WriteOnly | QIODevice::Append))
+		{
+			oldFile.write(file.readAll());
+			oldFile.close();
+			file.close();
+			file.remove();
+		}
+	}
+	else
+	{
+		QFile::rename(path, oldPath);
+	}
+
+	m_journalSize = 0;
+
+	m_compactionWatcher = new QFutureWatcher<qint64>(this);
+
+	connect(m_compactionWatcher, SIGNAL(finished()), this, SLOT(compactionFinished()));
+
+	m_compactionWatcher->setFuture(QtConcurrent::run(&CookieJar::saveCookies, SessionsManager::getWritableDataPath(QLatin1String("cookies.dat")), getCookies()));
+}
+
+void CookieJar::compactionFinished()
+{
+	if (!m_compactionWatcher)
+	{
+		return;
+	}
+
+	const qint64 size = m_compactionWatcher->result();
+
+	m_compactionWatcher->deleteLater();
+	m_compactionWatcher = NULL;
+
+	if (size >= 0)
+	{
+		m_snapshotSize = size;
+
+		QFile::remove(SessionsManager::getWritableDataPath(QLatin1String("cookies.log.old")));
+	}
+}
+
+void CookieJar::loadJournal(const QString &path)
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	qint64 position = 0;
+
+	while (!stream.atEnd())
+	{
+		CookieOperation operation;
+		QNetworkCookie cookie;
+
+		if (!readCookie(stream, operation, cookie))
+		{
+			break;
+		}
+
+		if (operation == RemoveCookie)
+		{
+			removeCookie(cookie);
+		}
+		else
+		{
+			addCookie(cookie);
+		}
+
+		position = file.pos();
+	}
+
+	const bool isTorn = (position < file.size());
+
+	file.close();
+
+// drop partially written record, otherwise records appended later would never be read
+	if (isTorn)
+	{
+		QFile::resize(path, position);
+	}
+
+	m_journalSize += position;
+}
+
+void CookieJar::journalCookie(CookieOperation operation, const QNetworkCookie &cookie)
+{
+	if (m_isPrivate)
+	{
+		return;
+	}
+
+	m_journal.append(qMakePair(((operation != RemoveCookie && cookie.isSessionCookie()) ? RemoveCookie : operation), cookie));
+
+	scheduleSave();
+}
+
+void CookieJar::writeCookie(QDataStream &stream, CookieOperation operation, const QNetworkCookie &cookie)
+{
+	stream << quint8(operation) << cookie.name() << cookie.domain() << cookie.path();
+
+	if (operation != RemoveCookie)
+	{
+		stream << cookie.value() << qint64(cookie.expirationDate().toMSecsSinceEpoch()) << quint8((cookie.isSecure() ? 1 : 0) | (cookie.isHttpOnly() ? 2 : 0));
+	}
+}
+
+bool CookieJar::readCookie(QDataStream &stream, CookieOperation &operation, QNetworkCookie &cookie)
+{
+	quint8 type;
+	QByteArray name;
+	QString domain;
+	QString path;
+
+	stream >> type >> name >> domain >> path;
+
+	if (stream.status() != QDataStream::Ok || type > RemoveCookie)
+	{
+		return false;
+	}
+
+	operation = static_cast<CookieOperation>(type);
+
+	cookie.setName(name);
+	cookie.setDomain(domain);
+	cookie.setPath(path);
+
+	if (operation != RemoveCookie)
+	{
+		QByteArray value;
+		qint64 expirationDate;
+		quint8 flags;
+
+		stream >> value >> expirationDate >> flags;
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			return false;
+		}
+
+		cookie.setValue(value);
+		cookie.setExpirationDate(QDateTime::fromMSecsSinceEpoch(expirationDate));
+		cookie.setSecure(flags & 1);
+		cookie.setHttpOnly(flags & 2);
+	}
+
+	return true;
+}
+
+qint64 CookieJar::saveCookies(const QString &path, const QList<QNetworkCookie> &cookies)
+{
+	QSaveFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return -1;
+	}
+
+	const QDateTime now = QDateTime::currentDateTimeUtc();
+	QList<QNetworkCookie> persistentCookies;
 
 	for (int i = 0; i < cookies.length(); ++i)
 	{
-		if (!cookies.at(i).isSessionCookie())
+		if (!cookies.at(i).isSessionCookie() && cookies.at(i).expirationDate() >= now)
+		{
+			persistentCookies.append(cookies.at(i));
+		}
+	}
+
+	QDataStream stream(&file);
+	stream << m_snapshotMagic << quint32(persistentCookies.length());
+
+	for (int i = 0; i < persistentCookies.length(); ++i)
+	{
+		writeCookie(stream, InsertCookie, persistentCookies.at(i));
+	}
+
+	const qint64 size = file.size();
+
+	return (file.commit() ? size : -1);
+}
+
+void CookieJar::setCookies(const QList<QNetworkCookie> &cookies)
+{
+	m_cookies.clear();
+
+	for (int i = 0; i < cookies.count(); ++i)
+	{
+		addCookie(cookies.at(i));
+	}
+}
+
+void CookieJar::removeExpiredCookies(const QString &domain)
+{
+	if (!m_cookies.contains(domain))
+	{
+		return;
+	}
+
+	const QDateTime now = QDateTime::currentDateTimeUtc();
+	QList<QNetworkCookie> &cookies = m_cookies[domain];
+
+	for (int i = (cookies.count() - 1); i >= 0; --i)
+	{
+		if (!cookies.at(i).isSessionCookie() && cookies.at(i).expirationDate() < now)
 		{
-			stream << cookies.at(i).toRawForm();
+			emit cookieRemoved(cookies.takeAt(i));
 		}
 	}
 
-	file.commit();
+	if (cookies.isEmpty())
+	{
+		m_cookies.remove(domain);
+	}
 }
 
 CookieJar* CookieJar::clone(QObject *parent)
 {
 	CookieJar *cookieJar = new CookieJar(m_isPrivate, parent);
-	cookieJar->setAllCookies(allCookies());
+	cookieJar->setCookies(getCookies());
 
 	return cookieJar;
 }
@@ -183,33 +509,164 @@ QList<QNetworkCookie> CookieJar::cookiesForUrl(const QUrl &url) const
 		return QList<QNetworkCookie>();
 	}
 
-	return QNetworkCookieJar::cookiesForUrl(url);
+	return getCookiesForUrl(url);
 }
 
 QList<QNetworkCookie> CookieJar::getCookiesForUrl(const QUrl &url) const
 {
-	return QNetworkCookieJar::cookiesForUrl(url);
+	const QString host = url.host().toLower();
+	const QString path = (url.path().isEmpty() ? QString(QLatin1Char('/')) : url.path());
+	const QDateTime now = QDateTime::currentDateTimeUtc();
+	const bool isSecure = (url.scheme() == QLatin1String("https"));
+	QList<QNetworkCookie> cookies;
+	QString domain = host;
+
+	while (!domain.isEmpty())
+	{
+		const QHash<QString, QList<QNetworkCookie> >::const_iterator iterator = m_cookies.constFind(domain);
+
+		if (iterator != m_cookies.constEnd())
+		{
+			const QList<QNetworkCookie> &domainCookies = iterator.value();
+
+			for (int i = 0; i < domainCookies.count(); ++i)
+			{
+				const QNetworkCookie &cookie = domainCookies.at(i);
+
+				if (!isParentDomain(host, cookie.domain()) || !isParentPath(path, cookie.path()) || (!cookie.isSessionCookie() && cookie.expirationDate() < now) || (cookie.isSecure() && !isSecure))
+				{
+					continue;
+				}
+
+				int position = 0;
+
+				while (position < cookies.count() && cookies.at(position).path().length() >= cookie.path().length())
+				{
+					++position;
+				}
+
+				cookies.insert(position, cookie);
+			}
+		}
+
+		const int position = domain.indexOf(QLatin1Char('.'));
+
+		if (position < 0)
+		{
+			break;
+		}
+
+		domain = domain.mid(position + 1);
+	}
+
+	return cookies;
 }
 
 QList<QNetworkCookie> CookieJar::getCookies(const QString &domain) const
 {
-	if (!domain.isEmpty())
+	QList<QNetworkCookie> cookies;
+
+	if (domain.isEmpty())
 	{
-		const QList<QNetworkCookie> cookies = allCookies();
-		QList<QNetworkCookie> domainCookies;
+		QHash<QString, QList<QNetworkCookie> >::const_iterator iterator;
 
-		for (int i = 0; i < cookies.length(); ++i)
+		for (iterator = m_cookies.constBegin(); iterator != m_cookies.constEnd(); ++iterator)
 		{
-			if (cookies.at(i).domain() == domain || (cookies.at(i).domain().startsWith(QLatin1Char('.')) && domain.endsWith(cookies.at(i).domain())))
+			cookies.append(iterator.value());
+		}
+
+		return cookies;
+	}
+
+	QString parentDomain = getDomain(domain);
+
+	while (!parentDomain.isEmpty())
+	{
+		const QList<QNetworkCookie> domainCookies = m_cookies.value(parentDomain);
+
+		for (int i = 0; i < domainCookies.count(); ++i)
+		{
+			if (domainCookies.at(i).domain() == domain || (domainCookies.at(i).domain().startsWith(QLatin1Char('.')) && domain.endsWith(domainCookies.at(i).domain())))
 			{
-				domainCookies.append(cookies.at(i));
+				cookies.append(domainCookies.at(i));
 			}
 		}
 
-		return domainCookies;
+		const int position = parentDomain.indexOf(QLatin1Char('.'));
+
+		if (position < 0)
+		{
+			break;
+		}
+
+		parentDomain = parentDomain.mid(position + 1);
+	}
+
+	return cookies;
+}
+
+QString CookieJar::getDomain(const QString &domain)
+{
+	return (domain.startsWith(QLatin1Char('.')) ? domain.mid(1) : domain).toLower();
+}
+
+bool CookieJar::addCookie(const QNetworkCookie &cookie)
+{
+	const QString domain = getDomain(cookie.domain());
+
+	removeCookie(cookie);
+	removeExpiredCookies(domain);
+
+	if (!cookie.isSessionCookie() && cookie.expirationDate() < QDateTime::currentDateTimeUtc())
+	{
+		return false;
+	}
+
+	QList<QNetworkCookie> &cookies = m_cookies[domain];
+	int position = 0;
+
+	while (position < cookies.count() && cookies.at(position).path().length() >= cookie.path().length())
+	{
+		++position;
+	}
+
+	cookies.insert(position, cookie);
+
+	return true;
+}
+
+bool CookieJar::removeCookie(const QNetworkCookie &cookie, QNetworkCookie *removedCookie)
+{
+	const QString domain = getDomain(cookie.domain());
+
+	if (!m_cookies.contains(domain))
+	{
+		return false;
+	}
+
+	QList<QNetworkCookie> &cookies = m_cookies[domain];
+
+	for (int i = 0; i < cookies.count(); ++i)
+	{
+		if (cookies.at(i).hasSameIdentifier(cookie))
+		{
+			if (removedCookie)
+			{
+				*removedCookie = cookies.at(i);
+			}
+
+			cookies.removeAt(i);
+
+			if (cookies.isEmpty())
+			{
+				m_cookies.remove(domain);
+			}
+
+			return true;
+		}
 	}
 
-	return allCookies();
+	return false;
 }
 
 bool CookieJar::insertCookie(const QNetworkCookie &cookie)
@@ -219,14 +676,25 @@ bool CookieJar::insertCookie(const QNetworkCookie &cookie)
 		return false;
 	}
 
-	const bool result = QNetworkCookieJar::insertCookie(cookie);
+	QNetworkCookie replacedCookie;
+	const bool isReplaced = removeCookie(cookie, &replacedCookie);
+	const bool result = addCookie(cookie);
+
+	if (isReplaced)
+	{
+		emit cookieRemoved(replacedCookie);
+	}
 
 	if (result)
 	{
-		scheduleSave();
+		journalCookie(InsertCookie, cookie);
 
 		emit cookieAdded(cookie);
 	}
+	else
+	{
+		journalCookie(RemoveCookie, cookie);
+	}
 
 	return result;
 }
@@ -238,11 +706,22 @@ bool CookieJar::updateCookie(const QNetworkCookie &cookie)
 		return false;
 	}
 
-	const bool result = QNetworkCookieJar::updateCookie(cookie);
+	QNetworkCookie removedCookie;
+	const bool isRemoved = removeCookie(cookie, &removedCookie);
+	const bool result = (isRemoved && addCookie(cookie));
 
 	if (result)
 	{
-		scheduleSave();
+		journalCookie(UpdateCookie, cookie);
+	}
+	else
+	{
+		journalCookie(RemoveCookie, cookie);
+
+		if (isRemoved)
+		{
+			emit cookieRemoved(removedCookie);
+		}
 	}
 
 	return result;
@@ -255,11 +734,11 @@ bool CookieJar::deleteCookie(const QNetworkCookie &cookie)
 		return false;
 	}
 
-	const bool result = QNetworkCookieJar::deleteCookie(cookie);
+	const bool result = removeCookie(cookie);
 
 	if (result)
 	{
-		scheduleSave();
+		journalCookie(RemoveCookie, cookie);
 
 		emit cookieRemoved(cookie);
 	}
@@ -269,25 +748,47 @@ bool CookieJar::deleteCookie(const QNetworkCookie &cookie)
 
 bool CookieJar::forceInsertCookie(const QNetworkCookie &cookie)
 {
-	const bool result = QNetworkCookieJar::insertCookie(cookie);
+	QNetworkCookie replacedCookie;
+	const bool isReplaced = removeCookie(cookie, &replacedCookie);
+	const bool result = addCookie(cookie);
+
+	if (isReplaced)
+	{
+		emit cookieRemoved(replacedCookie);
+	}
 
 	if (result)
 	{
-		scheduleSave();
+		journalCookie(InsertCookie, cookie);
 
 		emit cookieAdded(cookie);
 	}
+	else
+	{
+		journalCookie(RemoveCookie, cookie);
+	}
 
 	return result;
 }
 
 bool CookieJar::forceUpdateCookie(const QNetworkCookie &cookie)
 {
-	const bool result = QNetworkCookieJar::updateCookie(cookie);
+	QNetworkCookie removedCookie;
+	const bool isRemoved = removeCookie(cookie, &removedCookie);
+	const bool result = (isRemoved && addCookie(cookie));
 
 	if (result)
 	{
-		scheduleSave();
+		journalCookie(UpdateCookie, cookie);
+	}
+	else
+	{
+		journalCookie(RemoveCookie, cookie);
+
+		if (isRemoved)
+		{
+			emit cookieRemoved(removedCookie);
+		}
 	}
 
 	return result;
@@ -295,11 +796,11 @@ bool CookieJar::forceUpdateCookie(const QNetworkCookie &cookie)
 
 bool CookieJar::forceDeleteCookie(const QNetworkCookie &cookie)
 {
-	const bool result = QNetworkCookieJar::deleteCookie(cookie);
+	const bool result = removeCookie(cookie);
 
 	if (result)
 	{
-		scheduleSave();
+		journalCookie(RemoveCookie, cookie);
 
 		emit cookieRemoved(cookie);
 	}
@@ -327,6 +828,26 @@ bool CookieJar::hasCookie(const QNetworkCookie &cookie) const
 	return false;
 }
 
+bool CookieJar::isParentDomain(const QString &domain, const QString &reference)
+{
+	if (!reference.startsWith(QLatin1Char('.')))
+	{
+		return (domain.compare(reference, Qt::CaseInsensitive) == 0);
+	}
+
+	return (domain.endsWith(reference, Qt::CaseInsensitive) || domain.compare(reference.mid(1), Qt::CaseInsensitive) == 0);
+}
+
+bool CookieJar::isParentPath(const QString &path, const QString &reference)
+{
+	if (!path.startsWith(reference))
+	{
+		return false;
+	}
+
+	return (path.length() == reference.length() || reference.endsWith(QLatin1Char('/')) || path.at(reference.length()) == QLatin1Char('/'));
+}
+
 bool CookieJar::isDomainTheSame(const QUrl &first, const QUrl &second)
 {
 	const QString firstTld = first.topLevelDomain();
@@ -20,6 +20,9 @@
 #ifndef OTTER_COOKIEJAR_H
 #define OTTER_COOKIEJAR_H
 
+#include <QtCore/QDataStream>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QHash>
 #include <QtNetwork/QNetworkCookie>
 #include <QtNetwork/QNetworkCookieJar>
 
@@ -54,6 +57,7 @@ public:
 	};
 
 	explicit CookieJar(bool isPrivate, QObject *parent = NULL);
+	~CookieJar();
 
 	void clearCookies(int period = 0);
 	CookieJar* clone(QObject *parent = NULL);
@@ -73,17 +77,38 @@ protected:
 	void timerEvent(QTimerEvent *event);
 	void scheduleSave();
 	void save();
+	void compact();
+	void loadJournal(const QString &path);
+	void journalCookie(CookieOperation operation, const QNetworkCookie &cookie);
+	void setCookies(const QList<QNetworkCookie> &cookies);
+	void removeExpiredCookies(const QString &domain);
+	static void writeCookie(QDataStream &stream, CookieOperation operation, const QNetworkCookie &cookie);
+	static QString getDomain(const QString &domain);
+	static qint64 saveCookies(const QString &path, const QList<QNetworkCookie> &cookies);
+	bool addCookie(const QNetworkCookie &cookie);
+	bool removeCookie(const QNetworkCookie &cookie, QNetworkCookie *removedCookie = NULL);
+	static bool readCookie(QDataStream &stream, CookieOperation &operation, QNetworkCookie &cookie);
+	static bool isParentDomain(const QString &domain, const QString &reference);
+	static bool isParentPath(const QString &path, const QString &reference);
 
 protected slots:
 	void optionChanged(const QString &option, const QVariant &value);
+	void compactionFinished();
 
 private:
+	QHash<QString, QList<QNetworkCookie> > m_cookies;
+	QList<QPair<CookieOperation, QNetworkCookie> > m_journal;
+	QFutureWatcher<qint64> *m_compactionWatcher;
 	CookiesPolicy m_generalCookiesPolicy;
 	CookiesPolicy m_thirdPartyCookiesPolicy;
 	KeepMode m_keepMode;
+	qint64 m_journalSize;
+	qint64 m_snapshotSize;
 	int m_saveTimer;
 	bool m_isPrivate;
 
+	static const quint32 m_snapshotMagic;
+
 signals:
 	void cookieAdded(QNetworkCookie cookie);
 	void cookieRemoved(QNetworkCookie cookie);
@@ -18,38 +18,73 @@
 **************************************************************************/
 
 #include "HistoryManager.h"
+#include "HistoryWorker.h"
 #include "SessionsManager.h"
 #include "SettingsManager.h"
 #include "Utils.h"
 
 #include <QtCore/QBuffer>
-#include <QtCore/QFile>
-#include <QtCore/QTextStream>
 #include <QtCore/QTimerEvent>
-#include <QtSql/QSqlDatabase>
-#include <QtSql/QSqlField>
-#include <QtSql/QSqlQuery>
-#include <QtSql/QSqlResult>
 
 namespace Otter
 {
 
 HistoryManager* HistoryManager::m_instance = NULL;
 QStandardItemModel* HistoryManager::m_typedHistoryModel = NULL;
+QCache<QString, QIcon> HistoryManager::m_icons;
+QSet<QString> HistoryManager::m_pendingIcons;
+QSet<QString> HistoryManager::m_locations;
+QSet<QString> HistoryManager::m_addedLocations;
+QHash<quint64, HistoryEntry> HistoryManager::m_typedEntryRequests;
+QHash<quint64, QStringList> HistoryManager::m_typedHistoryRequests;
+quint64 HistoryManager::m_typedHistoryRequest = 0;
+QHash<QString, QStandardItem*> HistoryManager::m_typedHistoryItems;
+QHash<qint64, QString> HistoryManager::m_typedHistoryEntries;
+quint64 HistoryManager::m_request = 0;
 bool HistoryManager::m_isEnabled = false;
 bool HistoryManager::m_isStoringFavicons = true;
 
 HistoryManager::HistoryManager(QObject *parent) : QObject(parent),
+	m_thread(new QThread(this)),
+	m_worker(new HistoryWorker()),
 	m_cleanupTimer(0)
 {
+	qRegisterMetaType<HistoryEntry>("HistoryEntry");
+	qRegisterMetaType<QList<HistoryEntry> >("QList<HistoryEntry>");
+	qRegisterMetaType<QList<qint64> >("QList<qint64>");
+
+	m_icons.setMaxCost(2000);
+
+	m_worker->moveToThread(m_thread);
+	m_thread->start();
+
 	m_dayTimer = startTimer(QTime::currentTime().msecsTo(QTime(23, 59, 59, 999)));
 
+	connect(m_worker, SIGNAL(entriesReceived(quint64,QList<HistoryEntry>)), this, SLOT(handleEntriesReceived(quint64,QList<HistoryEntry>)));
+	connect(m_worker, SIGNAL(iconReceived(quint64,QByteArray)), this, SLOT(handleIconReceived(quint64,QByteArray)));
+	connect(m_worker, SIGNAL(iconLoaded(QUrl,QByteArray)), this, SLOT(handleIconLoaded(QUrl,QByteArray)));
+	connect(m_worker, SIGNAL(locationsLoaded(QStringList)), this, SLOT(handleLocationsLoaded(QStringList)));
+	connect(m_worker, SIGNAL(cleanupFinished()), this, SLOT(loadLocations()));
+	connect(m_worker, SIGNAL(entryAdded(quint64,qint64,bool)), this, SLOT(handleEntryAdded(quint64,qint64,bool)));
+	connect(m_worker, SIGNAL(entryUpdated(quint64,qint64,bool)), this, SLOT(handleEntryUpdated(quint64,qint64,bool)));
+	connect(m_worker, SIGNAL(entriesRemoved(QList<qint64>)), this, SLOT(handleEntriesRemoved(QList<qint64>)));
+
 	optionChanged(QLatin1String("History/RememberBrowsing"));
 	optionChanged(QLatin1String("History/StoreFavicons"));
 
 	connect(SettingsManager::getInstance(), SIGNAL(valueChanged(QString,QVariant)), this, SLOT(optionChanged(QString)));
 }
 
+HistoryManager::~HistoryManager()
+{
+	QMetaObject::invokeMethod(m_worker, "closeDatabase", Qt::BlockingQueuedConnection);
+
+	m_thread->quit();
+	m_thread->wait();
+
+	delete m_worker;
+}
+
 void HistoryManager::createInstance(QObject *parent)
 {
 	if (!m_instance)
@@ -66,39 +101,13 @@ void HistoryManager::timerEvent(QTimerEvent *event)
 
 		m_cleanupTimer = 0;
 
-		QSqlDatabase database = QSqlDatabase::database(QLatin1String("browsingHistory"));
-
-		if (!database.isValid())
-		{
-			return;
-		}
-
-		QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-		query.prepare(QLatin1String("SELECT COUNT(*) AS \"amount\" FROM \"visits\";"));
-		query.exec();
-
-		if (query.next())
-		{
-			const int amount = query.record().field(QLatin1String("amount")).value().toInt();
-
-			if (amount > SettingsManager::getValue(QLatin1String("History/BrowsingLimitAmountGlobal")).toInt())
-			{
-				removeOldEntries();
-			}
-		}
-
-		database.exec(QLatin1String("DELETE FROM \"icons\" WHERE \"id\" NOT IN(SELECT DISTINCT \"icon\" FROM \"visits\");"));
-		database.exec(QLatin1String("DELETE FROM \"locations\" WHERE \"id\" NOT IN(SELECT DISTINCT \"location\" FROM \"visits\");"));
-		database.exec(QLatin1String("DELETE FROM \"hosts\" WHERE \"id\" NOT IN(SELECT DISTINCT \"host\" FROM \"locations\");"));
-		database.exec(QLatin1String("VACUUM;"));
-
-		m_instance->updateTypedHistoryModel();
+		QMetaObject::invokeMethod(m_worker, "cleanup", Qt::QueuedConnection, Q_ARG(int, SettingsManager::getValue(QLatin1String("History/BrowsingLimitAmountGlobal")).toInt()));
 	}
 	else if (event->timerId() == m_dayTimer)
 	{
 		killTimer(m_dayTimer);
 
-		removeOldEntries(QDateTime::currentDateTime().addDays(SettingsManager::getValue(QLatin1String("History/BrowsingLimitPeriod")).toInt()));
+		QMetaObject::invokeMethod(m_worker, "removeOldEntries", Qt::QueuedConnection, Q_ARG(uint, QDateTime::currentDateTime().addDays(SettingsManager::getValue(QLatin1String("History/BrowsingLimitPeriod")).toInt()).toTime_t()), Q_ARG(int, SettingsManager::getValue(QLatin1String("History/BrowsingLimitAmountGlobal")).toInt()));
 
 		emit dayChanged();
 
@@ -106,6 +115,13 @@ void HistoryManager::timerEvent(QTimerEvent *event)
 	}
 }
 
+void HistoryManager::loadLocations()
+{
+	m_addedLocations.clear();
+
+	QMetaObject::invokeMethod(m_worker, "loadLocations", Qt::QueuedConnection);
+}
+
 void HistoryManager::scheduleCleanup()
 {
 	if (m_cleanupTimer == 0)
@@ -114,144 +130,326 @@ void HistoryManager::scheduleCleanup()
 	}
 }
 
-void HistoryManager::removeOldEntries(const QDateTime &date)
+void HistoryManager::clearHistory(int period)
 {
-	int timestamp = (date.isValid() ? date.toTime_t() : 0);
+	const uint since = ((period > 0) ? (QDateTime::currentDateTime().toTime_t() - (period * 3600)) : 0);
+
+	QMetaObject::invokeMethod(m_instance->m_worker, "clearHistory", Qt::BlockingQueuedConnection, Q_ARG(uint, since), Q_ARG(QString, SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.sqlite"))), Q_ARG(QString, SettingsManager::getValue(QLatin1String("Browser/SqliteJournalMode")).toString()));
+
+	if (period > 0)
+	{
+		m_instance->scheduleCleanup();
+	}
+
+	m_icons.clear();
+	m_locations.clear();
+
+	if (m_isEnabled)
+	{
+		m_instance->loadLocations();
+	}
+
+	m_instance->updateTypedHistoryModel();
+
+	emit m_instance->cleared();
+}
 
-	if (timestamp == 0)
+void HistoryManager::optionChanged(const QString &option)
+{
+	if (option == QLatin1String("History/RememberBrowsing") || option == QLatin1String("Browser/PrivateMode"))
 	{
-		QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-		query.prepare(QStringLiteral("SELECT \"visits\".\"time\" FROM \"visits\" ORDER BY \"visits\".\"time\" DESC LIMIT %1, 1;").arg(SettingsManager::getValue(QLatin1String("History/BrowsingLimitAmountGlobal")).toInt()));
-		query.exec();
+		const bool enabled = (SettingsManager::getValue(QLatin1String("History/RememberBrowsing")).toBool() && !SettingsManager::getValue(QLatin1String("Browser/PrivateMode")).toBool());
 
-		if (query.next())
+		if (enabled && !m_isEnabled)
 		{
-			timestamp = query.record().field(QLatin1String("time")).value().toInt();
-		}
+			QMetaObject::invokeMethod(m_worker, "openDatabase", Qt::QueuedConnection, Q_ARG(QString, SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.sqlite"))), Q_ARG(QString, SettingsManager::getValue(QLatin1String("Browser/SqliteJournalMode")).toString()));
+			QMetaObject::invokeMethod(m_worker, "loadRecentIcons", Qt::QueuedConnection, Q_ARG(int, 500));
 
-		if (timestamp == 0)
+			loadLocations();
+		}
+		else if (!enabled && m_isEnabled)
 		{
-			return;
+			QMetaObject::invokeMethod(m_worker, "closeDatabase", Qt::QueuedConnection);
+
+			m_icons.clear();
+			m_pendingIcons.clear();
+			m_locations.clear();
+			m_addedLocations.clear();
+			m_typedEntryRequests.clear();
 		}
+
+		m_isEnabled = enabled;
 	}
+	else if (option == QLatin1String("History/StoreFavicons"))
+	{
+		m_isStoringFavicons = SettingsManager::getValue(option).toBool();
 
-	QList<qint64> entries;
-	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	query.prepare(QLatin1String("SELECT \"visits\".\"id\" FROM \"visits\" WHERE \"visits\".\"time\" <= ?;"));
-	query.bindValue(0, timestamp);
-	query.exec();
+		m_icons.clear();
+	}
+}
 
-	while (query.next())
+void HistoryManager::updateTypedHistoryModel()
+{
+	if (!m_typedHistoryModel)
 	{
-		entries.append(query.record().field("id").value().toLongLong());
+		return;
 	}
 
-	removeEntries(entries);
-}
+	m_typedHistoryRequests.clear();
 
-void HistoryManager::clearHistory(int period)
-{
-	QSqlDatabase database = QSqlDatabase::database(QLatin1String("browsingHistory"));
+	if (m_isEnabled)
+	{
+		m_typedHistoryRequest = createRequest();
 
-	if (period > 0 && !database.isValid())
+		QMetaObject::invokeMethod(m_worker, "requestTypedEntries", Qt::QueuedConnection, Q_ARG(quint64, m_typedHistoryRequest));
+	}
+	else
 	{
-		database = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), QLatin1String("browsingHistory"));
-		database.setDatabaseName(SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.sqlite")));
-		database.open();
-		database.exec(QStringLiteral("PRAGMA journal_mode = %1;").arg(SettingsManager::getValue(QLatin1String("Browser/SqliteJournalMode")).toString()));
+		m_typedHistoryRequest = 0;
+
+		setTypedHistoryEntries(QList<HistoryEntry>());
 	}
+}
 
-	const QString path = SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.sqlite"));
+void HistoryManager::setTypedHistoryEntries(const QList<HistoryEntry> &entries)
+{
+	m_typedHistoryModel->clear();
+	m_typedHistoryItems.clear();
+	m_typedHistoryEntries.clear();
 
-	if (database.isValid())
+	for (int i = 0; i < entries.count(); ++i)
 	{
-		if (period > 0)
+		const QString url = entries.at(i).url.toString();
+
+		if (!m_typedHistoryItems.contains(url))
 		{
-			database.exec(QStringLiteral("DELETE FROM \"visits\" WHERE \"time\" >= %1;").arg(QDateTime::currentDateTime().toTime_t() - (period * 3600)));
+			QStandardItem *item = new QStandardItem(entries.at(i).icon, url);
+			item->setData(entries.at(i).time, Qt::UserRole);
+			item->setData(entries.at(i).identifier, (Qt::UserRole + 1));
 
-			m_instance->scheduleCleanup();
+			m_typedHistoryModel->appendRow(item);
+
+			m_typedHistoryItems[url] = item;
+			m_typedHistoryEntries[entries.at(i).identifier] = url;
 		}
-		else
+	}
+
+	emit typedHistoryModelModified();
+}
+
+void HistoryManager::addTypedHistoryEntry(qint64 entry, const QUrl &url, const QIcon &icon, const QDateTime &time)
+{
+	if (!m_typedHistoryModel)
+	{
+		return;
+	}
+
+	const QString key = url.toString();
+	QStandardItem *item = m_typedHistoryItems.value(key);
+
+	if (item)
+	{
+		m_typedHistoryModel->insertRow(0, m_typedHistoryModel->takeRow(item->row()));
+		m_typedHistoryEntries.remove(item->data(Qt::UserRole + 1).toLongLong());
+
+		if (!icon.isNull())
 		{
-			database.exec(QLatin1String("DELETE FROM \"visits\";"));
-			database.exec(QLatin1String("DELETE FROM \"locations\";"));
-			database.exec(QLatin1String("DELETE FROM \"hosts\";"));
-			database.exec(QLatin1String("DELETE FROM \"icons\";"));
-			database.exec(QLatin1String("VACUUM;"));
+			item->setIcon(icon);
 		}
 	}
-	else if (QFile::exists(path))
+	else
 	{
-		QFile::remove(path);
+		item = new QStandardItem(icon, key);
+
+		m_typedHistoryModel->insertRow(0, item);
+
+		m_typedHistoryItems[key] = item;
 	}
 
-	m_instance->updateTypedHistoryModel();
+	item->setData(time, Qt::UserRole);
+	item->setData(entry, (Qt::UserRole + 1));
 
-	emit m_instance->cleared();
+	m_typedHistoryEntries[entry] = key;
+
+	emit m_instance->typedHistoryModelModified();
 }
 
-void HistoryManager::optionChanged(const QString &option)
+void HistoryManager::removeTypedHistoryEntries(const QList<qint64> &entries)
 {
-	if (option == QLatin1String("History/RememberBrowsing") || option == QLatin1String("Browser/PrivateMode"))
+	if (!m_typedHistoryModel)
 	{
-		const bool enabled = (SettingsManager::getValue(QLatin1String("History/RememberBrowsing")).toBool() && !SettingsManager::getValue(QLatin1String("Browser/PrivateMode")).toBool());
+		return;
+	}
 
-		if (enabled && !m_isEnabled)
+	QStringList urls;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		if (m_typedHistoryEntries.contains(entries.at(i)))
 		{
-			QSqlDatabase database = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), QLatin1String("browsingHistory"));
-			database.setDatabaseName(SessionsManager::getWritableDataPath(QLatin1String("browsingHistory.sqlite")));
-			database.open();
-			database.exec(QStringLiteral("PRAGMA journal_mode = %1;").arg(SettingsManager::getValue(QLatin1String("Browser/SqliteJournalMode")).toString()));
+			urls.append(m_typedHistoryEntries.take(entries.at(i)));
+		}
+	}
 
-			if (!database.tables().contains(QLatin1String("visits")))
-			{
-				QFile file(QLatin1String(":/schemas/browsingHistory.sql"));
-				file.open(QIODevice::ReadOnly);
+	if (urls.isEmpty())
+	{
+		return;
+	}
+
+	if (m_isEnabled)
+	{
+		const quint64 request = createRequest();
 
-				QTextStream stream(&file);
+		m_typedHistoryRequests[request] = urls;
 
-				while (!stream.atEnd())
-				{
-					database.exec(stream.readLine());
-				}
-			}
+		QMetaObject::invokeMethod(m_instance->m_worker, "requestTypedEntries", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QStringList, urls));
+	}
+	else
+	{
+		updateTypedHistoryEntries(urls, QList<HistoryEntry>());
+	}
+}
+
+void HistoryManager::updateTypedHistoryEntries(const QStringList &urls, const QList<HistoryEntry> &entries)
+{
+	bool isModified = false;
+
+	for (int i = 0; i < urls.count(); ++i)
+	{
+		const QString key = urls.at(i);
+		QStandardItem *item = m_typedHistoryItems.value(key);
+
+// item was typed again while its replacement was being looked up
+		if (!item || m_typedHistoryEntries.contains(item->data(Qt::UserRole + 1).toLongLong()))
+		{
+			continue;
 		}
-		else if (!enabled && m_isEnabled)
+
+		const HistoryEntry historyEntry = entries.value(i);
+
+		if (historyEntry.identifier < 0)
 		{
-			QSqlDatabase::database(QLatin1String("browsingHistory")).close();
+			m_typedHistoryItems.remove(key);
+			m_typedHistoryModel->removeRow(item->row());
 		}
+		else
+		{
+			int row = item->row();
 
-		m_isEnabled = enabled;
+			while ((row + 1) < m_typedHistoryModel->rowCount() && m_typedHistoryModel->item(row + 1)->data(Qt::UserRole).toDateTime() > historyEntry.time)
+			{
+				++row;
+			}
+
+			if (row != item->row())
+			{
+				m_typedHistoryModel->insertRow(row, m_typedHistoryModel->takeRow(item->row()));
+			}
+
+			item->setData(historyEntry.time, Qt::UserRole);
+			item->setData(historyEntry.identifier, (Qt::UserRole + 1));
+
+			m_typedHistoryEntries[historyEntry.identifier] = key;
+		}
+
+		isModified = true;
 	}
-	else if (option == QLatin1String("History/StoreFavicons"))
+
+	if (isModified)
 	{
-		m_isStoringFavicons = SettingsManager::getValue(option).toBool();
+		emit m_instance->typedHistoryModelModified();
 	}
 }
 
-void HistoryManager::updateTypedHistoryModel()
+void HistoryManager::handleEntriesReceived(quint64 request, const QList<HistoryEntry> &entries)
 {
-	if (!m_typedHistoryModel)
+	if (m_typedHistoryModel && request == m_typedHistoryRequest)
 	{
+		QList<HistoryEntry> typedEntries(entries);
+
+		decodeIcons(typedEntries);
+
+		m_typedHistoryRequest = 0;
+
+		setTypedHistoryEntries(typedEntries);
+
 		return;
 	}
 
-	m_typedHistoryModel->clear();
+	if (m_typedHistoryRequests.contains(request))
+	{
+		updateTypedHistoryEntries(m_typedHistoryRequests.take(request), entries);
 
-	const QList<HistoryEntry> entries = getEntries(true);
+		return;
+	}
 
-	for (int i = 0; i < entries.count(); ++i)
+	QList<HistoryEntry> decodedEntries(entries);
+
+	decodeIcons(decodedEntries);
+
+	emit entriesReceived(request, decodedEntries);
+}
+
+void HistoryManager::handleIconReceived(quint64 request, const QByteArray &icon)
+{
+	emit iconReceived(request, getIcon(icon));
+}
+
+void HistoryManager::handleIconLoaded(const QUrl &url, const QByteArray &icon)
+{
+	const QString key = getIconKey(url);
+	QPixmap pixmap;
+	pixmap.loadFromData(icon);
+
+	m_pendingIcons.remove(key);
+	m_icons.insert(key, new QIcon(pixmap.isNull() ? QIcon() : QIcon(pixmap)));
+
+	emit iconLoaded(url);
+}
+
+void HistoryManager::handleLocationsLoaded(const QStringList &locations)
+{
+	m_locations = (locations.toSet() + m_addedLocations);
+}
+
+void HistoryManager::handleEntryAdded(quint64 request, qint64 entry, bool typed)
+{
+	const HistoryEntry historyEntry = m_typedEntryRequests.take(request);
+
+	if (entry >= 0)
 	{
-		if (m_typedHistoryModel->findItems(entries.at(i).url.toString()).isEmpty())
+		if (typed && m_typedHistoryModel)
 		{
-			QStandardItem *item = new QStandardItem(entries.at(i).icon, entries.at(i).url.toString());
-			item->setData(entries.at(i).time, Qt::UserRole);
-
-			m_typedHistoryModel->appendRow(item);
+			addTypedHistoryEntry(entry, historyEntry.url, historyEntry.icon, historyEntry.time);
 		}
+
+		emit entryAdded(entry);
 	}
 
-	emit typedHistoryModelModified();
+	emit requestFinished(request, entry);
+}
+
+void HistoryManager::handleEntryUpdated(quint64 request, qint64 entry, bool success)
+{
+	if (success)
+	{
+		scheduleCleanup();
+
+		emit entryUpdated(entry);
+	}
+
+	emit requestFinished(request, (success ? entry : -1));
+}
+
+void HistoryManager::handleEntriesRemoved(const QList<qint64> &entries)
+{
+	scheduleCleanup();
+	removeTypedHistoryEntries(entries);
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		emit entryRemoved(entries.at(i));
+	}
 }
 
 HistoryManager* HistoryManager::getInstance()
@@ -313,181 +511,275 @@ QIcon HistoryManager::getIcon(const QUrl &url)
 		return Utils::getIcon(QLatin1String("text-html"));
 	}
 
-	qint64 location = getLocation(url, false);
+	const QString key = getIconKey(url);
+	const QIcon *icon = m_icons.object(key);
 
-	if (location == 0)
+	if (icon)
 	{
-		QUrl mutableUrl(url);
-		mutableUrl.setPath(QString());
-		mutableUrl.setFragment(QString());
-
-		location = getLocation(mutableUrl, false);
+		return (icon->isNull() ? Utils::getIcon(QLatin1String("text-html")) : *icon);
 	}
 
-	if (location > 0)
+	if (m_isEnabled && !m_pendingIcons.contains(key))
 	{
-		QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-		query.prepare(QLatin1String("SELECT \"icons\".\"icon\" FROM \"visits\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\" WHERE \"visits\".\"location\" = ? LIMIT 1;"));
-		query.bindValue(0, location);
-		query.exec();
-
-		if (query.first())
-		{
-			QPixmap pixmap;
-			pixmap.loadFromData(query.record().field(QLatin1String("icon")).value().toByteArray());
+		m_pendingIcons.insert(key);
 
-			if (!pixmap.isNull())
-			{
-				return QIcon(pixmap);
-			}
-		}
+		QMetaObject::invokeMethod(m_instance->m_worker, "loadIcon", Qt::QueuedConnection, Q_ARG(QUrl, url));
 	}
 
 	return Utils::getIcon(QLatin1String("text-html"));
 }
 
-HistoryEntry HistoryManager::getEntry(const QSqlRecord &record)
+QString HistoryManager::getIconKey(const QUrl &url)
+{
+	return url.toString(QUrl::RemovePassword | QUrl::RemoveFragment);
+}
+
+void HistoryManager::addLocation(const QUrl &url)
+{
+	const QString key = HistoryWorker::getLocationKey(url);
+
+	m_locations.insert(key);
+	m_addedLocations.insert(key);
+}
+
+void HistoryManager::updateIcon(const QUrl &url, const QIcon &icon)
 {
-	if (record.isEmpty())
+	if (m_isStoringFavicons && !icon.isNull())
 	{
-		return HistoryEntry();
+		m_icons.insert(getIconKey(url), new QIcon(icon));
+
+		emit m_instance->iconLoaded(url);
 	}
+}
 
+QIcon HistoryManager::getIcon(const QByteArray &icon)
+{
 	QPixmap pixmap;
-	pixmap.loadFromData(record.field(QLatin1String("icon")).value().toByteArray());
+	pixmap.loadFromData(icon);
 
-	HistoryEntry historyEntry;
-	historyEntry.url = QUrl(record.field(QLatin1String("path")).value().toString());
-	historyEntry.url.setHost(record.field(QLatin1String("host")).value().toString());
-	historyEntry.url.setScheme(record.field(QLatin1String("scheme")).value().toString());
-	historyEntry.title = record.field(QLatin1String("title")).value().toString();
-	historyEntry.time = QDateTime::fromTime_t(record.field(QLatin1String("time")).value().toInt(), Qt::LocalTime);
-	historyEntry.icon = QIcon(pixmap);
-	historyEntry.identifier = record.field(QLatin1String("id")).value().toLongLong();
-	historyEntry.visits = record.field(QLatin1String("visits")).value().toInt();
-	historyEntry.typed = record.field(QLatin1String("typed")).value().toBool();
+	return (pixmap.isNull() ? Utils::getIcon(QLatin1String("text-html")) : QIcon(pixmap));
+}
 
-	return historyEntry;
+QByteArray HistoryManager::getIconData(const QIcon &icon)
+{
+	QByteArray data;
+
+	if (m_isStoringFavicons && !icon.isNull())
+	{
+		QBuffer buffer(&data);
+		buffer.open(QIODevice::WriteOnly);
+
+		icon.pixmap(QSize(16, 16)).save(&buffer, "PNG");
+	}
+
+	return data;
 }
 
-HistoryEntry HistoryManager::getEntry(qint64 entry)
+void HistoryManager::decodeIcons(QList<HistoryEntry> &entries)
 {
-	if (!m_isEnabled)
+	for (int i = 0; i < entries.count(); ++i)
 	{
-		return HistoryEntry();
+		decodeIcon(entries[i]);
 	}
+}
 
-	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	query.prepare(QLatin1String("SELECT \"visits\".\"id\", \"visits\".\"title\", \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\", \"icons\".\"icon\", \"visits\".\"time\", \"visits\".\"typed\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\" WHERE \"visits\".\"id\" = ?;"));
-	query.bindValue(0, entry);
-	query.exec();
+void HistoryManager::decodeIcon(HistoryEntry &entry)
+{
+	if (entry.iconData.isEmpty())
+	{
+		return;
+	}
 
-	if (query.first())
+// QPixmap may only be used on the GUI thread, worker passes raw icon data
+	QPixmap pixmap;
+	pixmap.loadFromData(entry.iconData);
+
+	entry.icon = QIcon(pixmap);
+	entry.iconData.clear();
+}
+
+HistoryEntry HistoryManager::getEntry(qint64 entry)
+{
+	HistoryEntry historyEntry;
+
+	if (m_isEnabled)
 	{
-		return getEntry(query.record());
+		QMetaObject::invokeMethod(m_instance->m_worker, "getEntry", Qt::BlockingQueuedConnection, Q_RETURN_ARG(HistoryEntry, historyEntry), Q_ARG(qint64, entry));
+
+		decodeIcon(historyEntry);
 	}
 
-	return HistoryEntry();
+	return historyEntry;
 }
 
 QList<HistoryEntry> HistoryManager::getEntries(bool typed)
+{
+	return getEntries(QDateTime(), QDateTime(), typed);
+}
+
+QList<HistoryEntry> HistoryManager::getEntries(const QDateTime &from, const QDateTime &to, bool typed)
 {
 	QList<HistoryEntry> entries;
 
-	if (!m_isEnabled)
+	if (m_isEnabled)
 	{
-		return entries;
+		QMetaObject::invokeMethod(m_instance->m_worker, "getEntries", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QList<HistoryEntry>, entries), Q_ARG(uint, (from.isValid() ? from.toTime_t() : 0)), Q_ARG(uint, (to.isValid() ? to.toTime_t() : 0)), Q_ARG(bool, typed));
+
+		decodeIcons(entries);
 	}
 
-	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	query.prepare(QLatin1String("SELECT \"visits\".\"id\", \"visits\".\"title\", \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\", \"icons\".\"icon\", \"visits\".\"time\", \"visits\".\"typed\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\"") + (typed ? QLatin1String(" WHERE \"visits\".\"typed\" = 1") : QString()) + QLatin1String(" ORDER BY \"visits\".\"time\" DESC;"));
-	query.exec();
+	return entries;
+}
+
+QList<HistoryEntry> HistoryManager::findEntries(const QString &query, int limit)
+{
+	QList<HistoryEntry> entries;
 
-	while (query.next())
+	if (m_isEnabled && !query.isEmpty())
 	{
-		entries.append(getEntry(query.record()));
+		QMetaObject::invokeMethod(m_instance->m_worker, "findEntries", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QList<HistoryEntry>, entries), Q_ARG(QString, query), Q_ARG(int, limit));
+
+		decodeIcons(entries);
 	}
 
 	return entries;
 }
 
-qint64 HistoryManager::getRecord(const QLatin1String &table, const QVariantHash &values, bool canCreate)
+QList<qint64> HistoryManager::getHostEntries(const QString &host)
 {
-	const QStringList keys = values.keys();
-	QStringList placeholders;
+	QList<qint64> entries;
 
-	for (int i = 0; i < keys.count(); ++i)
+	if (m_isEnabled)
 	{
-		placeholders.append(QString('?'));
+		QMetaObject::invokeMethod(m_instance->m_worker, "getHostEntries", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QList<qint64>, entries), Q_ARG(QString, host));
 	}
 
-	QSqlQuery selectQuery(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	selectQuery.prepare(QStringLiteral("SELECT \"id\" FROM \"%1\" WHERE \"%2\" = ?;").arg(table).arg(keys.join(QLatin1String("\" = ? AND \""))));
+	return entries;
+}
 
-	for (int i = 0; i < keys.count(); ++i)
+quint64 HistoryManager::createRequest()
+{
+	return ++m_request;
+}
+
+quint64 HistoryManager::requestEntries(const QDateTime &from, const QDateTime &to, bool typed, int limit, int offset)
+{
+	const quint64 request = createRequest();
+
+	if (m_isEnabled)
+	{
+		QMetaObject::invokeMethod(m_instance->m_worker, "requestEntries", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(uint, (from.isValid() ? from.toTime_t() : 0)), Q_ARG(uint, (to.isValid() ? to.toTime_t() : 0)), Q_ARG(bool, typed), Q_ARG(int, limit), Q_ARG(int, offset));
+	}
+	else
 	{
-		selectQuery.bindValue(i, values[keys.at(i)]);
+		QMetaObject::invokeMethod(m_instance, "entriesReceived", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QList<HistoryEntry>, QList<HistoryEntry>()));
 	}
 
-	selectQuery.exec();
+	return request;
+}
+
+quint64 HistoryManager::requestFindEntries(const QString &query, int limit)
+{
+	const quint64 request = createRequest();
 
-	if (selectQuery.first())
+	if (m_isEnabled && !query.isEmpty())
 	{
-		return selectQuery.record().field(QLatin1String("id")).value().toLongLong();
+		QMetaObject::invokeMethod(m_instance->m_worker, "requestFindEntries", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QString, query), Q_ARG(int, limit));
 	}
-
-	if (!canCreate)
+	else
 	{
-		return -1;
+		QMetaObject::invokeMethod(m_instance, "entriesReceived", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QList<HistoryEntry>, QList<HistoryEntry>()));
 	}
 
-	QSqlQuery insertQuery(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	insertQuery.prepare(QStringLiteral("INSERT INTO \"%1\" (\"%2\") VALUES(%3);").arg(table).arg(keys.join(QLatin1String("\", \""))).arg(placeholders.join(QLatin1String(", "))));
+	return request;
+}
+
+quint64 HistoryManager::requestEntry(qint64 entry)
+{
+	const quint64 request = createRequest();
 
-	for (int i = 0; i < keys.count(); ++i)
+	if (m_isEnabled)
+	{
+		QMetaObject::invokeMethod(m_instance->m_worker, "requestEntry", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(qint64, entry));
+	}
+	else
 	{
-		insertQuery.bindValue(i, values[keys.at(i)]);
+		QMetaObject::invokeMethod(m_instance, "entriesReceived", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QList<HistoryEntry>, QList<HistoryEntry>()));
 	}
 
-	insertQuery.exec();
+	return request;
+}
+
+quint64 HistoryManager::requestIcon(const QUrl &url)
+{
+	const quint64 request = createRequest();
+
+	if (m_isEnabled && url.scheme() != QLatin1String("about"))
+	{
+		QMetaObject::invokeMethod(m_instance->m_worker, "requestIcon", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QUrl, url));
+	}
+	else
+	{
+		QMetaObject::invokeMethod(m_instance, "iconReceived", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QIcon, getIcon(url)));
+	}
 
-	return insertQuery.lastInsertId().toULongLong();
+	return request;
 }
 
-qint64 HistoryManager::getLocation(const QUrl &url, bool canCreate)
+quint64 HistoryManager::requestAddEntry(const QUrl &url, const QString &title, const QIcon &icon, bool typed)
 {
-	QVariantHash hostsRecord;
-	hostsRecord[QLatin1String("host")] = url.host();
+	const quint64 request = createRequest();
+
+	if (!m_isEnabled || !url.isValid() || !SettingsManager::getValue(QLatin1String("History/RememberBrowsing"), url).toBool())
+	{
+		QMetaObject::invokeMethod(m_instance, "requestFinished", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(qint64, -1));
+	}
+	else
+	{
+		updateIcon(url, icon);
+		addLocation(url);
 
-	QUrl simplifiedUrl(url);
-	simplifiedUrl.setScheme(QString());
-	simplifiedUrl.setHost(QString());
+		if (typed)
+		{
+			HistoryEntry historyEntry;
+			historyEntry.url = url;
+			historyEntry.title = title;
+			historyEntry.time = QDateTime::currentDateTime();
+			historyEntry.icon = icon;
+			historyEntry.typed = true;
+
+			m_typedEntryRequests[request] = historyEntry;
+		}
 
-	QVariantHash locationsRecord;
-	locationsRecord[QLatin1String("host")] = getRecord(QLatin1String("hosts"), hostsRecord, canCreate);
-	locationsRecord[QLatin1String("scheme")] = url.scheme();
-	locationsRecord[QLatin1String("path")] = simplifiedUrl.toString(QUrl::RemovePassword | QUrl::NormalizePathSegments);
+		QMetaObject::invokeMethod(m_instance->m_worker, "requestAddEntry", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(QUrl, url), Q_ARG(QString, title), Q_ARG(QByteArray, getIconData(icon)), Q_ARG(bool, typed));
+	}
 
-	return getRecord(QLatin1String("locations"), locationsRecord, canCreate);
+	return request;
 }
 
-qint64 HistoryManager::getIcon(const QIcon &icon, bool canCreate)
+quint64 HistoryManager::requestUpdateEntry(qint64 entry, const QUrl &url, const QString &title, const QIcon &icon)
 {
-	if (!m_isStoringFavicons)
+	const quint64 request = createRequest();
+
+	if (!m_isEnabled || !url.isValid())
 	{
-		return 0;
+		QMetaObject::invokeMethod(m_instance, "requestFinished", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(qint64, -1));
 	}
+	else if (!SettingsManager::getValue(QLatin1String("History/RememberBrowsing"), url).toBool())
+	{
+		removeEntry(entry);
 
-	QByteArray data;
-	QBuffer buffer(&data);
-	buffer.open(QIODevice::WriteOnly);
-
-	icon.pixmap(QSize(16, 16)).save(&buffer, "PNG");
+		QMetaObject::invokeMethod(m_instance, "requestFinished", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(qint64, -1));
+	}
+	else
+	{
+		updateIcon(url, icon);
+		addLocation(url);
 
-	QVariantHash record;
-	record[QLatin1String("icon")] = data;
+		QMetaObject::invokeMethod(m_instance->m_worker, "requestUpdateEntry", Qt::QueuedConnection, Q_ARG(quint64, request), Q_ARG(qint64, entry), Q_ARG(QUrl, url), Q_ARG(QString, title), Q_ARG(QByteArray, getIconData(icon)));
+	}
 
-	return getRecord(QLatin1String("icons"), record, canCreate);
+	return request;
 }
 
 qint64 HistoryManager::addEntry(const QUrl &url, const QString &title, const QIcon &icon, bool typed)
@@ -497,35 +789,30 @@ qint64 HistoryManager::addEntry(const QUrl &url, const QString &title, const QIc
 		return -1;
 	}
 
-	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	query.prepare(QLatin1String("INSERT INTO \"visits\" (\"location\", \"icon\", \"title\", \"time\", \"typed\") VALUES(?, ?, ?, ?, ?);"));
-	query.bindValue(0, getLocation(url));
-	query.bindValue(1, getIcon(icon));
-	query.bindValue(2, title);
-	query.bindValue(3, QDateTime::currentDateTime().toTime_t());
-	query.bindValue(4, typed);
-	query.exec();
+	updateIcon(url, icon);
+	addLocation(url);
 
-	if (!query.lastInsertId().isNull())
-	{
-		const qint64 entry = query.lastInsertId().toLongLong();
+	qint64 entry = -1;
+
+	QMetaObject::invokeMethod(m_instance->m_worker, "addEntry", Qt::BlockingQueuedConnection, Q_RETURN_ARG(qint64, entry), Q_ARG(QUrl, url), Q_ARG(QString, title), Q_ARG(QByteArray, getIconData(icon)), Q_ARG(bool, typed));
 
+	if (entry >= 0)
+	{
 		if (typed)
 		{
-			m_instance->updateTypedHistoryModel();
+			addTypedHistoryEntry(entry, url, icon, QDateTime::currentDateTime());
 		}
 
 		emit m_instance->entryAdded(entry);
-
-		return entry;
 	}
 
-	return -1;
+	return entry;
 }
 
 bool HistoryManager::hasUrl(const QUrl &url)
 {
-	return (m_isEnabled && getLocation(url, false) >= 0);
+// queried for every link while rendering, so answer from locations mirrored from the worker instead of blocking on it
+	return (m_isEnabled && m_locations.contains(HistoryWorker::getLocationKey(url)));
 }
 
 bool HistoryManager::updateEntry(qint64 entry, const QUrl &url, const QString &title, const QIcon &icon)
@@ -542,15 +829,12 @@ bool HistoryManager::updateEntry(qint64 entry, const QUrl &url, const QString &t
 		return false;
 	}
 
-	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	query.prepare(QLatin1String("UPDATE \"visits\" SET \"location\" = ?, \"icon\" = ?, \"title\" = ? WHERE \"id\" = ?;"));
-	query.bindValue(0, getLocation(url));
-	query.bindValue(1, getIcon(icon));
-	query.bindValue(2, title);
-	query.bindValue(3, entry);
-	query.exec();
+	updateIcon(url, icon);
+	addLocation(url);
 
-	const bool success = (query.numRowsAffected() > 0);
+	bool success = false;
+
+	QMetaObject::invokeMethod(m_instance->m_worker, "updateEntry", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, success), Q_ARG(qint64, entry), Q_ARG(QUrl, url), Q_ARG(QString, title), Q_ARG(QByteArray, getIconData(icon)));
 
 	if (success)
 	{
@@ -564,26 +848,7 @@ bool HistoryManager::updateEntry(qint64 entry, const QUrl &url, const QString &t
 
 bool HistoryManager::removeEntry(qint64 entry)
 {
-	if (!m_isEnabled)
-	{
-		return false;
-	}
-
-	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	query.prepare(QLatin1String("DELETE FROM \"visits\" WHERE \"id\" = ?;"));
-	query.bindValue(0, entry);
-	query.exec();
-
-	const bool success = (query.numRowsAffected() > 0);
-
-	if (success)
-	{
-		m_instance->scheduleCleanup();
-
-		emit m_instance->entryRemoved(entry);
-	}
-
-	return success;
+	return removeEntries(QList<qint64>() << entry);
 }
 
 bool HistoryManager::removeEntries(const QList<qint64> &entries)
@@ -593,35 +858,13 @@ bool HistoryManager::removeEntries(const QList<qint64> &entries)
 		return false;
 	}
 
-	QStringList list;
-
-	for (int i = 0; i < entries.count(); ++i)
-	{
-		if (entries.at(i) >= 0)
-		{
-			list.append(QString::number(entries.at(i)));
-		}
-	}
-
-	if (list.isEmpty())
-	{
-		return false;
-	}
-
-	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
-	query.prepare(QStringLiteral("DELETE FROM \"visits\" WHERE \"id\" IN(%1);").arg(list.join(QLatin1String(", "))));
-	query.exec();
+	bool success = false;
 
-	const bool success = (query.numRowsAffected() > 0);
+	QMetaObject::invokeMethod(m_instance->m_worker, "removeEntries", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, success), Q_ARG(QList<qint64>, entries));
 
 	if (success)
 	{
-		m_instance->scheduleCleanup();
-
-		for (int i = 0; i < entries.count(); ++i)
-		{
-			emit m_instance->entryRemoved(entries.at(i));
-		}
+		m_instance->handleEntriesRemoved(entries);
 	}
 
 	return success;
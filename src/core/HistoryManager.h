@@ -21,11 +21,14 @@
 #define OTTER_HISTORYMANAGER_H
 
 #include <QtCore/QObject>
+#include <QtCore/QCache>
 #include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QThread>
 #include <QtCore/QUrl>
 #include <QtGui/QIcon>
 #include <QtGui/QStandardItemModel>
-#include <QtSql/QSqlRecord>
 
 namespace Otter
 {
@@ -36,6 +39,7 @@ struct HistoryEntry
 	QString title;
 	QDateTime time;
 	QIcon icon;
+	QByteArray iconData;
 	qint64 identifier;
 	int visits;
 	bool typed;
@@ -43,6 +47,8 @@ struct HistoryEntry
 	HistoryEntry() : identifier(-1), visits(0), typed(false) {}
 };
 
+class HistoryWorker;
+
 class HistoryManager : public QObject
 {
 	Q_OBJECT
@@ -55,7 +61,16 @@ public:
 	static QIcon getIcon(const QUrl &url);
 	static HistoryEntry getEntry(qint64 entry);
 	static QList<HistoryEntry> getEntries(bool typed = false);
+	static QList<HistoryEntry> getEntries(const QDateTime &from, const QDateTime &to, bool typed = false);
+	static QList<HistoryEntry> findEntries(const QString &query, int limit = 10);
+	static QList<qint64> getHostEntries(const QString &host);
 	static qint64 addEntry(const QUrl &url, const QString &title, const QIcon &icon, bool typed = false);
+	static quint64 requestFindEntries(const QString &query, int limit = 10);
+	static quint64 requestEntries(const QDateTime &from = QDateTime(), const QDateTime &to = QDateTime(), bool typed = false, int limit = 0, int offset = 0);
+	static quint64 requestEntry(qint64 entry);
+	static quint64 requestIcon(const QUrl &url);
+	static quint64 requestAddEntry(const QUrl &url, const QString &title, const QIcon &icon, bool typed = false);
+	static quint64 requestUpdateEntry(qint64 entry, const QUrl &url, const QString &title, const QIcon &icon);
 	static bool hasUrl(const QUrl &url);
 	static bool updateEntry(qint64 entry, const QUrl &url, const QString &title, const QIcon &icon);
 	static bool removeEntry(qint64 entry);
@@ -63,25 +78,53 @@ public:
 
 protected:
 	explicit HistoryManager(QObject *parent = NULL);
+	~HistoryManager();
 
 	void timerEvent(QTimerEvent *event);
 	void scheduleCleanup();
-	void removeOldEntries(const QDateTime &date = QDateTime());
-	static HistoryEntry getEntry(const QSqlRecord &record);
-	static qint64 getRecord(const QLatin1String &table, const QVariantHash &values, bool canCreate = true);
-	static qint64 getLocation(const QUrl &url, bool canCreate = true);
-	static qint64 getIcon(const QIcon &icon, bool canCreate = true);
+	static void updateIcon(const QUrl &url, const QIcon &icon);
+	static void addLocation(const QUrl &url);
+	static QString getIconKey(const QUrl &url);
+	static QIcon getIcon(const QByteArray &icon);
+	static QByteArray getIconData(const QIcon &icon);
+	static void decodeIcons(QList<HistoryEntry> &entries);
+	static void decodeIcon(HistoryEntry &entry);
+	static quint64 createRequest();
+	static void addTypedHistoryEntry(qint64 entry, const QUrl &url, const QIcon &icon, const QDateTime &time);
+	static void removeTypedHistoryEntries(const QList<qint64> &entries);
+	static void updateTypedHistoryEntries(const QStringList &urls, const QList<HistoryEntry> &entries);
+	void setTypedHistoryEntries(const QList<HistoryEntry> &entries);
 
 protected slots:
 	void optionChanged(const QString &option);
+	void loadLocations();
 	void updateTypedHistoryModel();
+	void handleEntriesReceived(quint64 request, const QList<HistoryEntry> &entries);
+	void handleIconReceived(quint64 request, const QByteArray &icon);
+	void handleIconLoaded(const QUrl &url, const QByteArray &icon);
+	void handleLocationsLoaded(const QStringList &locations);
+	void handleEntryAdded(quint64 request, qint64 entry, bool typed);
+	void handleEntryUpdated(quint64 request, qint64 entry, bool success);
+	void handleEntriesRemoved(const QList<qint64> &entries);
 
 private:
+	QThread *m_thread;
+	HistoryWorker *m_worker;
 	int m_cleanupTimer;
 	int m_dayTimer;
 
 	static HistoryManager *m_instance;
 	static QStandardItemModel *m_typedHistoryModel;
+	static QHash<QString, QStandardItem*> m_typedHistoryItems;
+	static QHash<qint64, QString> m_typedHistoryEntries;
+	static QCache<QString, QIcon> m_icons;
+	static QSet<QString> m_pendingIcons;
+	static QSet<QString> m_locations;
+	static QSet<QString> m_addedLocations;
+	static QHash<quint64, HistoryEntry> m_typedEntryRequests;
+	static QHash<quint64, QStringList> m_typedHistoryRequests;
+	static quint64 m_typedHistoryRequest;
+	static quint64 m_request;
 	static bool m_isEnabled;
 	static bool m_isStoringFavicons;
 
@@ -90,6 +133,10 @@ signals:
 	void entryAdded(qint64 entry);
 	void entryUpdated(qint64 entry);
 	void entryRemoved(qint64 entry);
+	void entriesReceived(quint64 request, const QList<HistoryEntry> &entries);
+	void iconReceived(quint64 request, const QIcon &icon);
+	void iconLoaded(const QUrl &url);
+	void requestFinished(quint64 request, qint64 entry);
 	void dayChanged();
 	void typedHistoryModelModified();
 };
@@ -0,0 +1,547 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "HistoryModel.h"
+#include "Utils.h"
+
+namespace Otter
+{
+
+const int HistoryModel::m_pageSize = 100;
+const int HistoryModel::m_searchLimit = 500;
+
+HistoryModel::HistoryModel(QObject *parent) : QAbstractItemModel(parent),
+	m_searchRequest(0)
+{
+	QStringList groups;
+	groups << tr("Today") << tr("Yesterday") << tr("Earlier This Week") << tr("Previous Week") << tr("Earlier This Month") << tr("Earlier This Year") << tr("Older");
+
+	m_groups.resize(groups.count());
+
+	for (int i = 0; i < groups.count(); ++i)
+	{
+		m_groups[i].title = groups.at(i);
+	}
+
+	reload();
+
+	connect(HistoryManager::getInstance(), SIGNAL(cleared()), this, SLOT(reload()));
+	connect(HistoryManager::getInstance(), SIGNAL(dayChanged()), this, SLOT(reload()));
+	connect(HistoryManager::getInstance(), SIGNAL(entryAdded(qint64)), this, SLOT(addEntry(qint64)));
+	connect(HistoryManager::getInstance(), SIGNAL(entryUpdated(qint64)), this, SLOT(updateEntry(qint64)));
+	connect(HistoryManager::getInstance(), SIGNAL(entryRemoved(qint64)), this, SLOT(removeEntry(qint64)));
+	connect(HistoryManager::getInstance(), SIGNAL(entriesReceived(quint64,QList<HistoryEntry>)), this, SLOT(entriesReceived(quint64,QList<HistoryEntry>)));
+	connect(HistoryManager::getInstance(), SIGNAL(iconLoaded(QUrl)), this, SLOT(updateIcon(QUrl)));
+}
+
+void HistoryModel::reload()
+{
+	const QDate date = QDate::currentDate();
+	QList<QDate> dates;
+	dates << date << date.addDays(-1) << date.addDays(-7) << date.addDays(-14) << date.addDays(-30) << date.addDays(-365);
+
+	m_entryGroups.clear();
+	m_entryRequests.clear();
+
+	for (int i = 0; i < m_groups.count(); ++i)
+	{
+		if (!m_groups.at(i).entries.isEmpty())
+		{
+			beginRemoveRows(index(i, 0), 0, (m_groups.at(i).entries.count() - 1));
+
+			m_groups[i].entries.clear();
+
+			endRemoveRows();
+		}
+
+		m_groups[i].from = ((i < dates.count()) ? QDateTime(dates.at(i)) : QDateTime());
+		m_groups[i].to = ((i > 0) ? m_groups.at(i - 1).from : QDateTime());
+		m_groups[i].request = 0;
+		m_groups[i].canFetchMore = m_filter.isEmpty();
+	}
+
+	if (m_filter.isEmpty())
+	{
+		m_searchRequest = 0;
+
+		for (int i = 0; i < m_groups.count(); ++i)
+		{
+			fetchMore(index(i, 0));
+		}
+	}
+	else
+	{
+		m_searchRequest = HistoryManager::requestFindEntries(m_filter, m_searchLimit);
+	}
+
+	emit loadingChanged(true);
+}
+
+void HistoryModel::setFilter(const QString &filter)
+{
+	if (filter != m_filter)
+	{
+		m_filter = filter;
+
+		reload();
+	}
+}
+
+void HistoryModel::fetchMore(const QModelIndex &parent)
+{
+	if (!parent.isValid() || parent.internalId() != 0 || parent.row() >= m_groups.count())
+	{
+		return;
+	}
+
+	HistoryGroup &group = m_groups[parent.row()];
+
+	if (group.request == 0 && group.canFetchMore)
+	{
+		group.request = HistoryManager::requestEntries(group.from, group.to, false, m_pageSize, group.entries.count());
+	}
+}
+
+void HistoryModel::addEntry(qint64 entry)
+{
+	if (m_entryGroups.contains(entry))
+	{
+		updateEntry(entry);
+
+		return;
+	}
+
+	if (!m_filter.isEmpty())
+	{
+		return;
+	}
+
+	m_entryRequests[HistoryManager::requestEntry(entry)] = entry;
+}
+
+void HistoryModel::updateEntry(qint64 entry)
+{
+	if (!m_entryGroups.contains(entry))
+	{
+		addEntry(entry);
+
+		return;
+	}
+
+	m_entryRequests[HistoryManager::requestEntry(entry)] = entry;
+}
+
+void HistoryModel::insertEntry(const HistoryEntry &historyEntry)
+{
+	const int group = getGroup(historyEntry.time);
+
+	if (!m_filter.isEmpty() || group < 0)
+	{
+		return;
+	}
+
+	const QList<HistoryEntry> &entries = m_groups.at(group).entries;
+	int row = 0;
+
+	while (row < entries.count() && (entries.at(row).time > historyEntry.time || (entries.at(row).time == historyEntry.time && entries.at(row).identifier > historyEntry.identifier)))
+	{
+		++row;
+	}
+
+	if (row == entries.count() && m_groups.at(group).canFetchMore)
+	{
+		return;
+	}
+
+	beginInsertRows(index(group, 0), row, row);
+
+	m_groups[group].entries.insert(row, historyEntry);
+	m_entryGroups[historyEntry.identifier] = group;
+
+	endInsertRows();
+}
+
+void HistoryModel::replaceEntry(const HistoryEntry &historyEntry)
+{
+	const int group = m_entryGroups.value(historyEntry.identifier, -1);
+	const int row = ((group < 0) ? -1 : getRow(group, historyEntry.identifier));
+
+	if (row < 0)
+	{
+		return;
+	}
+
+	m_groups[group].entries[row] = historyEntry;
+
+	emit dataChanged(index(row, 0, index(group, 0)), index(row, 2, index(group, 0)));
+}
+
+void HistoryModel::removeEntry(qint64 entry)
+{
+	const int group = m_entryGroups.value(entry, -1);
+	const int row = ((group < 0) ? -1 : getRow(group, entry));
+
+	if (row < 0)
+	{
+		return;
+	}
+
+	beginRemoveRows(index(group, 0), row, row);
+
+	m_groups[group].entries.removeAt(row);
+	m_entryGroups.remove(entry);
+
+	endRemoveRows();
+}
+
+void HistoryModel::updateIcon(const QUrl &url)
+{
+	const QUrl iconUrl = url.adjusted(QUrl::RemovePassword | QUrl::RemoveFragment);
+
+	for (int i = 0; i < m_groups.count(); ++i)
+	{
+		const QList<HistoryEntry> &entries = m_groups.at(i).entries;
+
+		for (int j = 0; j < entries.count(); ++j)
+		{
+			if (entries.at(j).url.adjusted(QUrl::RemovePassword | QUrl::RemoveFragment) == iconUrl)
+			{
+				const QModelIndex entryIndex = index(j, 0, index(i, 0));
+
+				emit dataChanged(entryIndex, entryIndex);
+			}
+		}
+	}
+}
+
+void HistoryModel::entriesReceived(quint64 request, const QList<HistoryEntry> &entries)
+{
+	if (m_entryRequests.contains(request))
+	{
+		const qint64 entry = m_entryRequests.take(request);
+
+		if (!entries.isEmpty() && entries.first().identifier == entry)
+		{
+			if (m_entryGroups.contains(entry))
+			{
+				replaceEntry(entries.first());
+			}
+			else
+			{
+				insertEntry(entries.first());
+			}
+		}
+
+		return;
+	}
+
+	if (request != 0 && request == m_searchRequest)
+	{
+		m_searchRequest = 0;
+
+		QVector<QList<HistoryEntry> > groups(m_groups.count());
+
+		for (int i = 0; i < entries.count(); ++i)
+		{
+			const int group = getGroup(entries.at(i).time);
+
+			if (group >= 0 && !m_entryGroups.contains(entries.at(i).identifier))
+			{
+				groups[group].append(entries.at(i));
+			}
+		}
+
+		for (int i = 0; i < groups.count(); ++i)
+		{
+			if (groups.at(i).isEmpty())
+			{
+				continue;
+			}
+
+			const int row = m_groups.at(i).entries.count();
+
+			beginInsertRows(index(i, 0), row, (row + groups.at(i).count() - 1));
+
+			m_groups[i].entries.append(groups.at(i));
+
+			for (int j = 0; j < groups.at(i).count(); ++j)
+			{
+				m_entryGroups[groups.at(i).at(j).identifier] = i;
+			}
+
+			endInsertRows();
+		}
+
+		emit loadingChanged(false);
+
+		return;
+	}
+
+	int group = -1;
+
+	for (int i = 0; i < m_groups.count(); ++i)
+	{
+		if (m_groups.at(i).request == request)
+		{
+			group = i;
+
+			break;
+		}
+	}
+
+	if (group < 0)
+	{
+		return;
+	}
+
+	m_groups[group].request = 0;
+	m_groups[group].canFetchMore = (entries.count() >= m_pageSize);
+
+	QList<HistoryEntry> newEntries;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		if (!m_entryGroups.contains(entries.at(i).identifier))
+		{
+			newEntries.append(entries.at(i));
+		}
+	}
+
+	if (!newEntries.isEmpty())
+	{
+		const int row = m_groups.at(group).entries.count();
+
+		beginInsertRows(index(group, 0), row, (row + newEntries.count() - 1));
+
+		m_groups[group].entries.append(newEntries);
+
+		for (int i = 0; i < newEntries.count(); ++i)
+		{
+			m_entryGroups[newEntries.at(i).identifier] = group;
+		}
+
+		endInsertRows();
+	}
+
+	if (!isLoading())
+	{
+		emit loadingChanged(false);
+	}
+}
+
+QModelIndex HistoryModel::index(int row, int column, const QModelIndex &parent) const
+{
+	if (!hasIndex(row, column, parent))
+	{
+		return QModelIndex();
+	}
+
+	return createIndex(row, column, (parent.isValid() ? quintptr(parent.row() + 1) : quintptr(0)));
+}
+
+QModelIndex HistoryModel::parent(const QModelIndex &index) const
+{
+	if (!index.isValid() || index.internalId() == 0)
+	{
+		return QModelIndex();
+	}
+
+	return createIndex((index.internalId() - 1), 0, quintptr(0));
+}
+
+QModelIndex HistoryModel::getEntryIndex(qint64 entry) const
+{
+	const int group = m_entryGroups.value(entry, -1);
+	const int row = ((group < 0) ? -1 : getRow(group, entry));
+
+	return ((row < 0) ? QModelIndex() : index(row, 0, index(group, 0)));
+}
+
+QVariant HistoryModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid())
+	{
+		return QVariant();
+	}
+
+	if (index.internalId() == 0)
+	{
+		if (index.column() == 0 && index.row() < m_groups.count())
+		{
+			if (role == Qt::DisplayRole)
+			{
+				return m_groups.at(index.row()).title;
+			}
+
+			if (role == Qt::DecorationRole)
+			{
+				return Utils::getIcon(QLatin1String("inode-directory"));
+			}
+		}
+
+		return QVariant();
+	}
+
+	const int group = (index.internalId() - 1);
+
+	if (group >= m_groups.count() || index.row() >= m_groups.at(group).entries.count())
+	{
+		return QVariant();
+	}
+
+	const HistoryEntry &entry = m_groups.at(group).entries.at(index.row());
+
+	switch (role)
+	{
+		case Qt::DisplayRole:
+			if (index.column() == 0)
+			{
+				return entry.url.toString().replace(QLatin1String("%23"), QString(QLatin1Char('#')));
+			}
+
+			if (index.column() == 1)
+			{
+				return (entry.title.isEmpty() ? tr("(Untitled)") : entry.title);
+			}
+
+			return entry.time.toString();
+		case Qt::DecorationRole:
+			if (index.column() == 0)
+			{
+				return HistoryManager::getIcon(entry.url);
+			}
+
+			break;
+		case IdentifierRole:
+			return entry.identifier;
+		case UrlRole:
+			return entry.url;
+		case TimeRole:
+			return entry.time;
+		default:
+			break;
+	}
+
+	return QVariant();
+}
+
+QVariant HistoryModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation == Qt::Horizontal && role == Qt::DisplayRole)
+	{
+		switch (section)
+		{
+			case 0:
+				return tr("Address");
+			case 1:
+				return tr("Title");
+			case 2:
+				return tr("Date");
+			default:
+				break;
+		}
+	}
+
+	return QVariant();
+}
+
+int HistoryModel::getGroup(const QDateTime &time) const
+{
+	for (int i = 0; i < m_groups.count(); ++i)
+	{
+		if (!m_groups.at(i).from.isValid() || time >= m_groups.at(i).from)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int HistoryModel::getRow(int group, qint64 entry) const
+{
+	const QList<HistoryEntry> &entries = m_groups.at(group).entries;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		if (entries.at(i).identifier == entry)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int HistoryModel::rowCount(const QModelIndex &parent) const
+{
+	if (!parent.isValid())
+	{
+		return m_groups.count();
+	}
+
+	if (parent.internalId() == 0 && parent.column() == 0 && parent.row() < m_groups.count())
+	{
+		return m_groups.at(parent.row()).entries.count();
+	}
+
+	return 0;
+}
+
+int HistoryModel::columnCount(const QModelIndex &parent) const
+{
+	Q_UNUSED(parent)
+
+	return 3;
+}
+
+bool HistoryModel::canFetchMore(const QModelIndex &parent) const
+{
+	return (parent.isValid() && parent.internalId() == 0 && parent.row() < m_groups.count() && m_groups.at(parent.row()).canFetchMore);
+}
+
+bool HistoryModel::hasChildren(const QModelIndex &parent) const
+{
+	if (!parent.isValid())
+	{
+		return true;
+	}
+
+	return (parent.internalId() == 0 && parent.column() == 0 && parent.row() < m_groups.count() && (!m_groups.at(parent.row()).entries.isEmpty() || m_groups.at(parent.row()).canFetchMore));
+}
+
+bool HistoryModel::isLoading() const
+{
+	if (m_searchRequest != 0)
+	{
+		return true;
+	}
+
+	for (int i = 0; i < m_groups.count(); ++i)
+	{
+		if (m_groups.at(i).request != 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+}
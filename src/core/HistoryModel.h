@@ -0,0 +1,102 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_HISTORYMODEL_H
+#define OTTER_HISTORYMODEL_H
+
+#include "HistoryManager.h"
+
+#include <QtCore/QAbstractItemModel>
+
+namespace Otter
+{
+
+class HistoryModel : public QAbstractItemModel
+{
+	Q_OBJECT
+
+public:
+	enum HistoryRole
+	{
+		TitleRole = Qt::DisplayRole,
+		IdentifierRole = Qt::UserRole,
+		UrlRole = (Qt::UserRole + 1),
+		TimeRole = (Qt::UserRole + 2)
+	};
+
+	explicit HistoryModel(QObject *parent = NULL);
+
+	void fetchMore(const QModelIndex &parent);
+	QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+	QModelIndex parent(const QModelIndex &index) const;
+	QModelIndex getEntryIndex(qint64 entry) const;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+	int rowCount(const QModelIndex &parent = QModelIndex()) const;
+	int columnCount(const QModelIndex &parent = QModelIndex()) const;
+	bool canFetchMore(const QModelIndex &parent) const;
+	bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+	bool isLoading() const;
+
+public slots:
+	void reload();
+	void setFilter(const QString &filter);
+
+protected:
+	struct HistoryGroup
+	{
+		QString title;
+		QList<HistoryEntry> entries;
+		QDateTime from;
+		QDateTime to;
+		quint64 request;
+		bool canFetchMore;
+
+		HistoryGroup() : request(0), canFetchMore(true) {}
+	};
+
+	void insertEntry(const HistoryEntry &historyEntry);
+	void replaceEntry(const HistoryEntry &historyEntry);
+	int getGroup(const QDateTime &time) const;
+	int getRow(int group, qint64 entry) const;
+
+protected slots:
+	void addEntry(qint64 entry);
+	void updateEntry(qint64 entry);
+	void removeEntry(qint64 entry);
+	void updateIcon(const QUrl &url);
+	void entriesReceived(quint64 request, const QList<HistoryEntry> &entries);
+
+private:
+	QVector<HistoryGroup> m_groups;
+	QHash<qint64, int> m_entryGroups;
+	QHash<quint64, qint64> m_entryRequests;
+	QString m_filter;
+	quint64 m_searchRequest;
+
+	static const int m_pageSize;
+	static const int m_searchLimit;
+
+signals:
+	void loadingChanged(bool isLoading);
+};
+
+}
+
+#endif
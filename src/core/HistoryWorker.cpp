@@ -0,0 +1,828 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "HistoryWorker.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QTextStream>
+#include <QtCore/QTimerEvent>
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlField>
+
+namespace Otter
+{
+
+const int HistoryWorker::m_schemaVersion = 2;
+
+HistoryWorker::HistoryWorker(QObject *parent) : QObject(parent),
+	m_transactionTimer(0),
+	m_hasSearchIndex(false)
+{
+}
+
+void HistoryWorker::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() == m_transactionTimer)
+	{
+		commitTransaction();
+	}
+}
+
+void HistoryWorker::beginTransaction()
+{
+	if (m_transactionTimer == 0)
+	{
+		QSqlDatabase::database(QLatin1String("browsingHistory")).transaction();
+
+		m_transactionTimer = startTimer(1000);
+	}
+}
+
+void HistoryWorker::commitTransaction()
+{
+	if (m_transactionTimer != 0)
+	{
+		killTimer(m_transactionTimer);
+
+		m_transactionTimer = 0;
+
+		QSqlDatabase::database(QLatin1String("browsingHistory")).commit();
+	}
+}
+
+void HistoryWorker::openDatabase(const QString &path, const QString &journalMode)
+{
+	QSqlDatabase database = QSqlDatabase::database(QLatin1String("browsingHistory"), false);
+
+	if (!database.isValid())
+	{
+		database = QSqlDatabase::addDatabase(QLatin1String("QSQLITE"), QLatin1String("browsingHistory"));
+	}
+
+	database.setDatabaseName(path);
+	database.open();
+	database.exec(QStringLiteral("PRAGMA journal_mode = %1;").arg(journalMode));
+
+	if (!database.tables().contains(QLatin1String("visits")))
+	{
+		executeScript(QLatin1String(":/schemas/browsingHistory.sql"));
+	}
+
+	updateSchema();
+
+	m_hasSearchIndex = database.tables().contains(QLatin1String("locations_search"));
+
+	if (!m_hasSearchIndex)
+	{
+// earlier migrations could leave triggers behind without the index they write to, making every change of visits fail
+		database.exec(QLatin1String("DROP TRIGGER IF EXISTS \"visits_search_insert\";"));
+		database.exec(QLatin1String("DROP TRIGGER IF EXISTS \"visits_search_update\";"));
+		database.exec(QLatin1String("DROP TRIGGER IF EXISTS \"locations_search_delete\";"));
+	}
+}
+
+void HistoryWorker::updateSchema()
+{
+	QSqlDatabase database = QSqlDatabase::database(QLatin1String("browsingHistory"));
+	QSqlQuery query(database);
+	query.exec(QLatin1String("PRAGMA user_version;"));
+
+	int version = (query.next() ? query.value(0).toInt() : 0);
+
+	query.finish();
+
+	while (version < m_schemaVersion)
+	{
+		database.transaction();
+
+		if (!executeScript(QStringLiteral(":/schemas/browsingHistory-%1.sql").arg(version + 1)) || database.exec(QStringLiteral("PRAGMA user_version = %1;").arg(version + 1)).lastError().isValid())
+		{
+// leave database at last complete version, migration will be retried on next start
+			database.rollback();
+
+			return;
+		}
+
+		database.commit();
+
+		++version;
+	}
+}
+
+bool HistoryWorker::executeScript(const QString &path)
+{
+	QSqlDatabase database = QSqlDatabase::database(QLatin1String("browsingHistory"));
+	QFile file(path);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return false;
+	}
+
+	QTextStream stream(&file);
+
+	while (!stream.atEnd())
+	{
+		const QString line = stream.readLine().trimmed();
+
+		if (!line.isEmpty() && database.exec(line).lastError().isValid())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void HistoryWorker::closeDatabase()
+{
+	commitTransaction();
+
+	m_queries.clear();
+
+	QSqlDatabase::database(QLatin1String("browsingHistory"), false).close();
+}
+
+void HistoryWorker::clearHistory(uint since, const QString &path, const QString &journalMode)
+{
+	commitTransaction();
+
+	QSqlDatabase database = QSqlDatabase::database(QLatin1String("browsingHistory"));
+
+	if (since > 0 && !database.isOpen())
+	{
+		openDatabase(path, journalMode);
+
+		database = QSqlDatabase::database(QLatin1String("browsingHistory"));
+	}
+
+	if (database.isOpen())
+	{
+		if (since > 0)
+		{
+			database.exec(QStringLiteral("DELETE FROM \"visits\" WHERE \"time\" >= %1;").arg(since));
+		}
+		else
+		{
+			database.exec(QLatin1String("DELETE FROM \"visits\";"));
+			database.exec(QLatin1String("DELETE FROM \"locations\";"));
+			database.exec(QLatin1String("DELETE FROM \"hosts\";"));
+			database.exec(QLatin1String("DELETE FROM \"icons\";"));
+			database.exec(QLatin1String("VACUUM;"));
+		}
+	}
+	else if (QFile::exists(path))
+	{
+		QFile::remove(path);
+	}
+}
+
+void HistoryWorker::cleanup(int amount)
+{
+	commitTransaction();
+
+	QSqlDatabase database = QSqlDatabase::database(QLatin1String("browsingHistory"));
+
+	if (!database.isOpen())
+	{
+		return;
+	}
+
+	QSqlQuery query(database);
+	query.prepare(QLatin1String("SELECT COUNT(*) AS \"amount\" FROM \"visits\";"));
+	query.exec();
+
+	if (query.next() && query.record().field(QLatin1String("amount")).value().toInt() > amount)
+	{
+		query.finish();
+
+		removeOldEntries(0, amount);
+	}
+
+	query.finish();
+
+	commitTransaction();
+
+	database.exec(QLatin1String("DELETE FROM \"icons\" WHERE NOT EXISTS(SELECT 1 FROM \"visits\" WHERE \"visits\".\"icon\" = \"icons\".\"id\");"));
+	database.exec(QLatin1String("DELETE FROM \"locations\" WHERE NOT EXISTS(SELECT 1 FROM \"visits\" WHERE \"visits\".\"location\" = \"locations\".\"id\");"));
+	database.exec(QLatin1String("DELETE FROM \"hosts\" WHERE NOT EXISTS(SELECT 1 FROM \"locations\" WHERE \"locations\".\"host\" = \"hosts\".\"id\");"));
+
+	query.exec(QLatin1String("PRAGMA page_count;"));
+
+	const int pages = (query.next() ? query.value(0).toInt() : 0);
+
+	query.exec(QLatin1String("PRAGMA freelist_count;"));
+
+	const int freePages = (query.next() ? query.value(0).toInt() : 0);
+
+	query.finish();
+
+	if (freePages > 0 && freePages >= (pages / 4))
+	{
+		database.exec(QLatin1String("VACUUM;"));
+	}
+
+	emit cleanupFinished();
+}
+
+void HistoryWorker::removeOldEntries(uint timestamp, int amount)
+{
+	const QList<qint64> entries = getOldEntries(timestamp, amount);
+
+	if (removeEntries(entries))
+	{
+		emit entriesRemoved(entries);
+	}
+}
+
+void HistoryWorker::requestEntries(quint64 request, uint from, uint to, bool typed, int limit, int offset)
+{
+	emit entriesReceived(request, getEntries(from, to, typed, limit, offset));
+}
+
+void HistoryWorker::requestFindEntries(quint64 request, const QString &query, int limit)
+{
+	emit entriesReceived(request, findEntries(query, limit));
+}
+
+void HistoryWorker::requestEntry(quint64 request, qint64 entry)
+{
+	const HistoryEntry historyEntry = getEntry(entry);
+	QList<HistoryEntry> entries;
+
+	if (historyEntry.identifier >= 0)
+	{
+		entries.append(historyEntry);
+	}
+
+	emit entriesReceived(request, entries);
+}
+
+void HistoryWorker::requestTypedEntries(quint64 request)
+{
+	emit entriesReceived(request, getTypedEntries());
+}
+
+void HistoryWorker::requestTypedEntries(quint64 request, const QStringList &urls)
+{
+	QList<HistoryEntry> entries;
+
+	for (int i = 0; i < urls.count(); ++i)
+	{
+		entries.append(getTypedEntry(QUrl(urls.at(i))));
+	}
+
+	emit entriesReceived(request, entries);
+}
+
+void HistoryWorker::requestIcon(quint64 request, const QUrl &url)
+{
+	emit iconReceived(request, getIcon(url));
+}
+
+void HistoryWorker::loadIcon(const QUrl &url)
+{
+	emit iconLoaded(url, getIcon(url));
+}
+
+void HistoryWorker::loadRecentIcons(int amount)
+{
+	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
+	query.prepare(QLatin1String("SELECT \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\", \"icons\".\"icon\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\" WHERE \"visits\".\"icon\" > 0 GROUP BY \"visits\".\"location\" ORDER BY MAX(\"visits\".\"time\") DESC LIMIT ?;"));
+	query.bindValue(0, amount);
+	query.exec();
+
+	while (query.next())
+	{
+		const QSqlRecord record = query.record();
+		QUrl url(record.field(QLatin1String("path")).value().toString());
+		url.setHost(record.field(QLatin1String("host")).value().toString());
+		url.setScheme(record.field(QLatin1String("scheme")).value().toString());
+
+		emit iconLoaded(url, record.field(QLatin1String("icon")).value().toByteArray());
+	}
+}
+
+void HistoryWorker::loadLocations()
+{
+	QStringList locations;
+	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
+	query.prepare(QLatin1String("SELECT \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\" FROM \"locations\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\";"));
+	query.exec();
+
+	while (query.next())
+	{
+		const QSqlRecord record = query.record();
+		QUrl url(record.field(QLatin1String("path")).value().toString());
+		url.setHost(record.field(QLatin1String("host")).value().toString());
+		url.setScheme(record.field(QLatin1String("scheme")).value().toString());
+
+		locations.append(getLocationKey(url));
+	}
+
+	emit locationsLoaded(locations);
+}
+
+void HistoryWorker::requestAddEntry(quint64 request, const QUrl &url, const QString &title, const QByteArray &icon, bool typed)
+{
+	emit entryAdded(request, addEntry(url, title, icon, typed), typed);
+}
+
+void HistoryWorker::requestUpdateEntry(quint64 request, qint64 entry, const QUrl &url, const QString &title, const QByteArray &icon)
+{
+	emit entryUpdated(request, entry, updateEntry(entry, url, title, icon));
+}
+
+QList<qint64> HistoryWorker::getOldEntries(uint timestamp, int amount)
+{
+	QList<qint64> entries;
+
+	if (timestamp == 0)
+	{
+		QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
+		query.prepare(QStringLiteral("SELECT \"visits\".\"time\" FROM \"visits\" ORDER BY \"visits\".\"time\" DESC LIMIT %1, 1;").arg(amount));
+		query.exec();
+
+		if (query.next())
+		{
+			timestamp = query.record().field(QLatin1String("time")).value().toUInt();
+		}
+
+		if (timestamp == 0)
+		{
+			return entries;
+		}
+	}
+
+	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
+	query.prepare(QLatin1String("SELECT \"visits\".\"id\" FROM \"visits\" WHERE \"visits\".\"time\" <= ?;"));
+	query.bindValue(0, timestamp);
+	query.exec();
+
+	while (query.next())
+	{
+		entries.append(query.record().field(QLatin1String("id")).value().toLongLong());
+	}
+
+	return entries;
+}
+
+QSqlQuery& HistoryWorker::getQuery(const QString &statement)
+{
+	QHash<QString, QSqlQuery>::iterator iterator = m_queries.find(statement);
+
+	if (iterator == m_queries.end())
+	{
+		QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
+		query.prepare(statement);
+
+		iterator = m_queries.insert(statement, query);
+	}
+
+	return iterator.value();
+}
+
+HistoryEntry HistoryWorker::getEntry(const QSqlRecord &record)
+{
+	if (record.isEmpty())
+	{
+		return HistoryEntry();
+	}
+
+	HistoryEntry historyEntry;
+	historyEntry.url = QUrl(record.field(QLatin1String("path")).value().toString());
+	historyEntry.url.setHost(record.field(QLatin1String("host")).value().toString());
+	historyEntry.url.setScheme(record.field(QLatin1String("scheme")).value().toString());
+	historyEntry.title = record.field(QLatin1String("title")).value().toString();
+	historyEntry.time = QDateTime::fromTime_t(record.field(QLatin1String("time")).value().toInt(), Qt::LocalTime);
+	historyEntry.iconData = record.field(QLatin1String("icon")).value().toByteArray();
+	historyEntry.identifier = record.field(QLatin1String("id")).value().toLongLong();
+	historyEntry.visits = record.field(QLatin1String("visits")).value().toInt();
+	historyEntry.typed = record.field(QLatin1String("typed")).value().toBool();
+
+	return historyEntry;
+}
+
+HistoryEntry HistoryWorker::getEntry(qint64 entry)
+{
+	QSqlQuery &query = getQuery(QLatin1String("SELECT \"visits\".\"id\", \"visits\".\"title\", \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\", \"icons\".\"icon\", \"visits\".\"time\", \"visits\".\"typed\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\" WHERE \"visits\".\"id\" = ?;"));
+	query.bindValue(0, entry);
+	query.exec();
+
+	const HistoryEntry historyEntry = (query.first() ? getEntry(query.record()) : HistoryEntry());
+
+	query.finish();
+
+	return historyEntry;
+}
+
+HistoryEntry HistoryWorker::getTypedEntry(const QUrl &url)
+{
+	const qint64 location = getLocation(url, false);
+
+	if (location < 0)
+	{
+		return HistoryEntry();
+	}
+
+	QSqlQuery &query = getQuery(QLatin1String("SELECT \"visits\".\"id\", \"visits\".\"title\", \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\", \"icons\".\"icon\", \"visits\".\"time\", \"visits\".\"typed\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\" WHERE \"visits\".\"location\" = ? AND \"visits\".\"typed\" = 1 ORDER BY \"visits\".\"time\" DESC, \"visits\".\"id\" DESC LIMIT 1;"));
+	query.bindValue(0, location);
+	query.exec();
+
+	const HistoryEntry historyEntry = (query.first() ? getEntry(query.record()) : HistoryEntry());
+
+	query.finish();
+
+	return historyEntry;
+}
+
+QList<HistoryEntry> HistoryWorker::getEntries(uint from, uint to, bool typed, int limit, int offset)
+{
+	QStringList conditions;
+
+	if (from > 0)
+	{
+		conditions.append(QLatin1String("\"visits\".\"time\" >= :from"));
+	}
+
+	if (to > 0)
+	{
+		conditions.append(QLatin1String("\"visits\".\"time\" < :to"));
+	}
+
+	if (typed)
+	{
+		conditions.append(QLatin1String("\"visits\".\"typed\" = 1"));
+	}
+
+	QSqlQuery &query = getQuery(QLatin1String("SELECT \"visits\".\"id\", \"visits\".\"title\", \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\", \"visits\".\"time\", \"visits\".\"typed\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\"") + (conditions.isEmpty() ? QString() : QLatin1String(" WHERE ") + conditions.join(QLatin1String(" AND "))) + QLatin1String(" ORDER BY \"visits\".\"time\" DESC, \"visits\".\"id\" DESC") + ((limit > 0) ? QLatin1String(" LIMIT :limit OFFSET :offset;") : QLatin1String(";")));
+
+	if (from > 0)
+	{
+		query.bindValue(QLatin1String(":from"), from);
+	}
+
+	if (to > 0)
+	{
+		query.bindValue(QLatin1String(":to"), to);
+	}
+
+	if (limit > 0)
+	{
+		query.bindValue(QLatin1String(":limit"), limit);
+		query.bindValue(QLatin1String(":offset"), offset);
+	}
+
+	query.exec();
+
+	QList<HistoryEntry> entries;
+
+	while (query.next())
+	{
+		entries.append(getEntry(query.record()));
+	}
+
+	query.finish();
+
+	return entries;
+}
+
+QList<HistoryEntry> HistoryWorker::getTypedEntries()
+{
+	QSqlQuery &query = getQuery(QLatin1String("SELECT MAX(\"visits\".\"id\") AS \"id\", \"visits\".\"title\", \"locations\".\"scheme\", \"locations\".\"path\", \"hosts\".\"host\", \"icons\".\"icon\", MAX(\"visits\".\"time\") AS \"time\", COUNT(\"visits\".\"id\") AS \"visits\", \"visits\".\"typed\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\" WHERE \"visits\".\"typed\" = 1 GROUP BY \"visits\".\"location\" ORDER BY \"time\" DESC;"));
+	query.exec();
+
+	QList<HistoryEntry> entries;
+
+	while (query.next())
+	{
+		entries.append(getEntry(query.record()));
+	}
+
+	query.finish();
+
+	return entries;
+}
+
+QList<HistoryEntry> HistoryWorker::findEntries(const QString &query, int limit)
+{
+	const QStringList words = query.split(QRegularExpression(QLatin1String("\\W+")), QString::SkipEmptyParts);
+	QList<HistoryEntry> entries;
+
+	if (words.isEmpty())
+	{
+		return entries;
+	}
+
+	const QString frecency(QLatin1String("SUM((CASE WHEN \"visits\".\"time\" >= (strftime('%s', 'now') - 345600) THEN 100 WHEN \"visits\".\"time\" >= (strftime('%s', 'now') - 1209600) THEN 70 WHEN \"visits\".\"time\" >= (strftime('%s', 'now') - 2678400) THEN 50 WHEN \"visits\".\"time\" >= (strftime('%s', 'now') - 7776000) THEN 30 ELSE 10 END) * (1 + \"visits\".\"typed\")) AS \"frecency\""));
+
+	if (m_hasSearchIndex)
+	{
+		QStringList terms;
+
+		for (int i = 0; i < words.count(); ++i)
+		{
+			terms.append(QStringLiteral("\"%1*\"").arg(words.at(i)));
+		}
+
+		QSqlQuery &searchQuery = getQuery(QLatin1String("SELECT \"locations_search\".\"url\", \"locations_search\".\"title\", MAX(\"visits\".\"id\") AS \"id\", MAX(\"visits\".\"time\") AS \"time\", COUNT(\"visits\".\"id\") AS \"visits\", MAX(\"visits\".\"typed\") AS \"typed\", ") + frecency + QLatin1String(" FROM \"locations_search\" INNER JOIN \"visits\" ON \"visits\".\"location\" = \"locations_search\".\"rowid\" WHERE \"locations_search\" MATCH ? GROUP BY \"locations_search\".\"rowid\" ORDER BY \"frecency\" DESC LIMIT ?;"));
+		searchQuery.bindValue(0, terms.join(QLatin1Char(' ')));
+		searchQuery.bindValue(1, limit);
+
+		entries = getEntries(searchQuery);
+
+		if (entries.count() >= limit)
+		{
+			return entries;
+		}
+
+// full text index only matches word prefixes, so look up substrings of host names, like "ample" in "example.com", in much smaller hosts table
+		QSqlQuery &hostQuery = getQuery(QLatin1String("SELECT (\"locations\".\"scheme\" || '://' || \"hosts\".\"host\" || \"locations\".\"path\") AS \"url\", \"visits\".\"title\", MAX(\"visits\".\"id\") AS \"id\", MAX(\"visits\".\"time\") AS \"time\", COUNT(\"visits\".\"id\") AS \"visits\", MAX(\"visits\".\"typed\") AS \"typed\", ") + frecency + QLatin1String(" FROM \"hosts\" INNER JOIN \"locations\" ON \"locations\".\"host\" = \"hosts\".\"id\" INNER JOIN \"visits\" ON \"visits\".\"location\" = \"locations\".\"id\" WHERE \"hosts\".\"host\" LIKE ? ESCAPE '\\' GROUP BY \"visits\".\"location\" ORDER BY \"frecency\" DESC LIMIT ?;"));
+		hostQuery.bindValue(0, getLikePattern(query));
+		hostQuery.bindValue(1, limit);
+
+		const QList<HistoryEntry> hostEntries = getEntries(hostQuery);
+		QSet<qint64> identifiers;
+
+		for (int i = 0; i < entries.count(); ++i)
+		{
+			identifiers.insert(entries.at(i).identifier);
+		}
+
+		for (int i = 0; (i < hostEntries.count() && entries.count() < limit); ++i)
+		{
+			if (!identifiers.contains(hostEntries.at(i).identifier))
+			{
+				entries.append(hostEntries.at(i));
+			}
+		}
+
+		return entries;
+	}
+
+	QSqlQuery &searchQuery = getQuery(QLatin1String("SELECT (\"locations\".\"scheme\" || '://' || \"hosts\".\"host\" || \"locations\".\"path\") AS \"url\", \"visits\".\"title\", MAX(\"visits\".\"id\") AS \"id\", MAX(\"visits\".\"time\") AS \"time\", COUNT(\"visits\".\"id\") AS \"visits\", MAX(\"visits\".\"typed\") AS \"typed\", ") + frecency + QLatin1String(" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" WHERE \"url\" LIKE ? ESCAPE '\\' OR \"visits\".\"title\" LIKE ? ESCAPE '\\' GROUP BY \"visits\".\"location\" ORDER BY \"frecency\" DESC LIMIT ?;"));
+	searchQuery.bindValue(0, getLikePattern(query));
+	searchQuery.bindValue(1, getLikePattern(query));
+	searchQuery.bindValue(2, limit);
+
+	return getEntries(searchQuery);
+}
+
+QList<HistoryEntry> HistoryWorker::getEntries(QSqlQuery &query)
+{
+	QList<HistoryEntry> entries;
+
+	query.exec();
+
+	while (query.next())
+	{
+		const QSqlRecord record = query.record();
+		HistoryEntry entry;
+		entry.url = QUrl(record.field(QLatin1String("url")).value().toString());
+		entry.title = record.field(QLatin1String("title")).value().toString();
+		entry.time = QDateTime::fromTime_t(record.field(QLatin1String("time")).value().toInt(), Qt::LocalTime);
+		entry.identifier = record.field(QLatin1String("id")).value().toLongLong();
+		entry.visits = record.field(QLatin1String("visits")).value().toInt();
+		entry.typed = record.field(QLatin1String("typed")).value().toBool();
+
+		entries.append(entry);
+	}
+
+	query.finish();
+
+	return entries;
+}
+
+QList<qint64> HistoryWorker::getHostEntries(const QString &host)
+{
+	QSqlQuery &query = getQuery(QLatin1String("SELECT \"visits\".\"id\" FROM \"visits\" LEFT JOIN \"locations\" ON \"visits\".\"location\" = \"locations\".\"id\" LEFT JOIN \"hosts\" ON \"locations\".\"host\" = \"hosts\".\"id\" WHERE \"hosts\".\"host\" = ?;"));
+	query.bindValue(0, host);
+	query.exec();
+
+	QList<qint64> entries;
+
+	while (query.next())
+	{
+		entries.append(query.record().field(QLatin1String("id")).value().toLongLong());
+	}
+
+	query.finish();
+
+	return entries;
+}
+
+QByteArray HistoryWorker::getIcon(const QUrl &url)
+{
+	qint64 location = getLocation(url, false);
+
+	if (location == 0)
+	{
+		QUrl mutableUrl(url);
+		mutableUrl.setPath(QString());
+		mutableUrl.setFragment(QString());
+
+		location = getLocation(mutableUrl, false);
+	}
+
+	QByteArray icon;
+
+	if (location > 0)
+	{
+		QSqlQuery &query = getQuery(QLatin1String("SELECT \"icons\".\"icon\" FROM \"visits\" LEFT JOIN \"icons\" ON \"visits\".\"icon\" = \"icons\".\"id\" WHERE \"visits\".\"location\" = ? LIMIT 1;"));
+		query.bindValue(0, location);
+		query.exec();
+
+		if (query.first())
+		{
+			icon = query.record().field(QLatin1String("icon")).value().toByteArray();
+		}
+
+		query.finish();
+	}
+
+	return icon;
+}
+
+qint64 HistoryWorker::getRecord(const QLatin1String &table, const QVariantHash &values, bool canCreate)
+{
+	const QStringList keys = values.keys();
+	QStringList placeholders;
+
+	for (int i = 0; i < keys.count(); ++i)
+	{
+		placeholders.append(QString('?'));
+	}
+
+	QSqlQuery &selectQuery = getQuery(QStringLiteral("SELECT \"id\" FROM \"%1\" WHERE \"%2\" = ?;").arg(table).arg(keys.join(QLatin1String("\" = ? AND \""))));
+
+	for (int i = 0; i < keys.count(); ++i)
+	{
+		selectQuery.bindValue(i, values[keys.at(i)]);
+	}
+
+	selectQuery.exec();
+
+	if (selectQuery.first())
+	{
+		const qint64 record = selectQuery.record().field(QLatin1String("id")).value().toLongLong();
+
+		selectQuery.finish();
+
+		return record;
+	}
+
+	selectQuery.finish();
+
+	if (!canCreate)
+	{
+		return -1;
+	}
+
+	beginTransaction();
+
+	QSqlQuery &insertQuery = getQuery(QStringLiteral("INSERT INTO \"%1\" (\"%2\") VALUES(%3);").arg(table).arg(keys.join(QLatin1String("\", \""))).arg(placeholders.join(QLatin1String(", "))));
+
+	for (int i = 0; i < keys.count(); ++i)
+	{
+		insertQuery.bindValue(i, values[keys.at(i)]);
+	}
+
+	insertQuery.exec();
+
+	return insertQuery.lastInsertId().toULongLong();
+}
+
+qint64 HistoryWorker::getLocation(const QUrl &url, bool canCreate)
+{
+	QVariantHash hostsRecord;
+	hostsRecord[QLatin1String("host")] = url.host();
+
+	QUrl simplifiedUrl(url);
+	simplifiedUrl.setScheme(QString());
+	simplifiedUrl.setHost(QString());
+
+	QVariantHash locationsRecord;
+	locationsRecord[QLatin1String("host")] = getRecord(QLatin1String("hosts"), hostsRecord, canCreate);
+	locationsRecord[QLatin1String("scheme")] = url.scheme();
+	locationsRecord[QLatin1String("path")] = simplifiedUrl.toString(QUrl::RemovePassword | QUrl::NormalizePathSegments);
+
+	return getRecord(QLatin1String("locations"), locationsRecord, canCreate);
+}
+
+qint64 HistoryWorker::getIcon(const QByteArray &icon, bool canCreate)
+{
+	if (icon.isEmpty())
+	{
+		return 0;
+	}
+
+	QVariantHash record;
+	record[QLatin1String("icon")] = icon;
+
+	return getRecord(QLatin1String("icons"), record, canCreate);
+}
+
+qint64 HistoryWorker::addEntry(const QUrl &url, const QString &title, const QByteArray &icon, bool typed)
+{
+	beginTransaction();
+
+	QSqlQuery &query = getQuery(QLatin1String("INSERT INTO \"visits\" (\"location\", \"icon\", \"title\", \"time\", \"typed\") VALUES(?, ?, ?, ?, ?);"));
+	query.bindValue(0, getLocation(url));
+	query.bindValue(1, getIcon(icon));
+	query.bindValue(2, title);
+	query.bindValue(3, QDateTime::currentDateTime().toTime_t());
+	query.bindValue(4, typed);
+	query.exec();
+
+	return (query.lastInsertId().isNull() ? -1 : query.lastInsertId().toLongLong());
+}
+
+bool HistoryWorker::hasLocation(const QUrl &url)
+{
+	return (getLocation(url, false) >= 0);
+}
+
+QString HistoryWorker::getLikePattern(const QString &text)
+{
+	QString pattern(text);
+	pattern.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+	pattern.replace(QLatin1Char('%'), QLatin1String("\\%"));
+	pattern.replace(QLatin1Char('_'), QLatin1String("\\_"));
+
+	return QLatin1Char('%') + pattern + QLatin1Char('%');
+}
+
+QString HistoryWorker::getLocationKey(const QUrl &url)
+{
+	return url.toString(QUrl::RemovePassword | QUrl::NormalizePathSegments);
+}
+
+bool HistoryWorker::updateEntry(qint64 entry, const QUrl &url, const QString &title, const QByteArray &icon)
+{
+	beginTransaction();
+
+	QSqlQuery &query = getQuery(QLatin1String("UPDATE \"visits\" SET \"location\" = ?, \"icon\" = ?, \"title\" = ? WHERE \"id\" = ?;"));
+	query.bindValue(0, getLocation(url));
+	query.bindValue(1, getIcon(icon));
+	query.bindValue(2, title);
+	query.bindValue(3, entry);
+	query.exec();
+
+	return (query.numRowsAffected() > 0);
+}
+
+bool HistoryWorker::removeEntries(const QList<qint64> &entries)
+{
+	QStringList list;
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		if (entries.at(i) >= 0)
+		{
+			list.append(QString::number(entries.at(i)));
+		}
+	}
+
+	if (list.isEmpty())
+	{
+		return false;
+	}
+
+	beginTransaction();
+
+	if (list.count() == 1)
+	{
+		QSqlQuery &query = getQuery(QLatin1String("DELETE FROM \"visits\" WHERE \"id\" = ?;"));
+		query.bindValue(0, list.first().toLongLong());
+		query.exec();
+
+		return (query.numRowsAffected() > 0);
+	}
+
+	QSqlQuery query(QSqlDatabase::database(QLatin1String("browsingHistory")));
+	query.prepare(QStringLiteral("DELETE FROM \"visits\" WHERE \"id\" IN(%1);").arg(list.join(QLatin1String(", "))));
+	query.exec();
+
+	return (query.numRowsAffected() > 0);
+}
+
+}
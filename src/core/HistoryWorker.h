@@ -0,0 +1,104 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_HISTORYWORKER_H
+#define OTTER_HISTORYWORKER_H
+
+#include "HistoryManager.h"
+
+#include <QtCore/QObject>
+#include <QtSql/QSqlQuery>
+#include <QtSql/QSqlRecord>
+
+namespace Otter
+{
+
+class HistoryWorker : public QObject
+{
+	Q_OBJECT
+
+public:
+	explicit HistoryWorker(QObject *parent = NULL);
+
+public slots:
+	void openDatabase(const QString &path, const QString &journalMode);
+	void closeDatabase();
+	void clearHistory(uint since, const QString &path, const QString &journalMode);
+	void cleanup(int amount);
+	void removeOldEntries(uint timestamp, int amount);
+	void requestEntries(quint64 request, uint from, uint to, bool typed, int limit, int offset);
+	void requestFindEntries(quint64 request, const QString &query, int limit);
+	void requestEntry(quint64 request, qint64 entry);
+	void requestTypedEntries(quint64 request);
+	void requestTypedEntries(quint64 request, const QStringList &urls);
+	void requestIcon(quint64 request, const QUrl &url);
+	void loadIcon(const QUrl &url);
+	void loadRecentIcons(int amount);
+	void loadLocations();
+	void requestAddEntry(quint64 request, const QUrl &url, const QString &title, const QByteArray &icon, bool typed);
+	void requestUpdateEntry(quint64 request, qint64 entry, const QUrl &url, const QString &title, const QByteArray &icon);
+	HistoryEntry getEntry(qint64 entry);
+	HistoryEntry getTypedEntry(const QUrl &url);
+	QList<HistoryEntry> getEntries(uint from, uint to, bool typed, int limit = 0, int offset = 0);
+	QList<HistoryEntry> getTypedEntries();
+	QList<HistoryEntry> findEntries(const QString &query, int limit);
+	QList<qint64> getHostEntries(const QString &host);
+	QByteArray getIcon(const QUrl &url);
+	qint64 addEntry(const QUrl &url, const QString &title, const QByteArray &icon, bool typed);
+	bool hasLocation(const QUrl &url);
+	bool updateEntry(qint64 entry, const QUrl &url, const QString &title, const QByteArray &icon);
+	bool removeEntries(const QList<qint64> &entries);
+	static QString getLocationKey(const QUrl &url);
+
+protected:
+	void timerEvent(QTimerEvent *event);
+	void beginTransaction();
+	void commitTransaction();
+	void updateSchema();
+	bool executeScript(const QString &path);
+	QList<qint64> getOldEntries(uint timestamp, int amount);
+	QSqlQuery& getQuery(const QString &statement);
+	static HistoryEntry getEntry(const QSqlRecord &record);
+	static QString getLikePattern(const QString &text);
+	QList<HistoryEntry> getEntries(QSqlQuery &query);
+	qint64 getRecord(const QLatin1String &table, const QVariantHash &values, bool canCreate = true);
+	qint64 getLocation(const QUrl &url, bool canCreate = true);
+	qint64 getIcon(const QByteArray &icon, bool canCreate = true);
+
+private:
+	QHash<QString, QSqlQuery> m_queries;
+	int m_transactionTimer;
+	bool m_hasSearchIndex;
+
+	static const int m_schemaVersion;
+
+signals:
+	void entriesReceived(quint64 request, const QList<HistoryEntry> &entries);
+	void iconReceived(quint64 request, const QByteArray &icon);
+	void iconLoaded(const QUrl &url, const QByteArray &icon);
+	void locationsLoaded(const QStringList &locations);
+	void entryAdded(quint64 request, qint64 entry, bool typed);
+	void entryUpdated(quint64 request, qint64 entry, bool success);
+	void entriesRemoved(const QList<qint64> &entries);
+	void cleanupFinished();
+};
+
+}
+
+#endif
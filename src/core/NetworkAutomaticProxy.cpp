@@ -23,6 +23,7 @@
 
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDate>
+#include <QtCore/QThread>
 #include <QtNetwork/QHostInfo>
 #include <QtNetwork/QNetworkInterface>
 
@@ -31,46 +32,86 @@ namespace Otter
 
 QStringList NetworkAutomaticProxy::m_months = QStringList() << QLatin1String("jan") << QLatin1String("feb") << QLatin1String("mar") << QLatin1String("apr") << QLatin1String("may") << QLatin1String("jun") << QLatin1String("jul") << QLatin1String("aug") << QLatin1String("sep") << QLatin1String("oct") << QLatin1String("nov") << QLatin1String("dec");
 QStringList NetworkAutomaticProxy::m_days = QStringList() << QLatin1String("mon") << QLatin1String("tue") << QLatin1String("wed") << QLatin1String("thu") << QLatin1String("fri") << QLatin1String("sat") << QLatin1String("sun");
-
-NetworkAutomaticProxy::NetworkAutomaticProxy()
+const qint64 NetworkAutomaticProxy::m_configurationTimeToLive = 300000;
+const qint64 NetworkAutomaticProxy::m_hostTimeToLive = 60000;
+const qint64 NetworkAutomaticProxy::m_failedHostTimeToLive = 10000;
+const int NetworkAutomaticProxy::m_cacheLimit = 1000;
+
+NetworkAutomaticProxy::NetworkAutomaticProxy(QObject *parent) : QObject(parent),
+	m_engine(NULL),
+	m_hasStaticHosts(false)
 {
 	m_proxies.insert(QLatin1String("ERROR"), QList<QNetworkProxy>() << QNetworkProxy(QNetworkProxy::DefaultProxy));
 	m_proxies.insert(QLatin1String("DIRECT"), QList<QNetworkProxy>() << QNetworkProxy(QNetworkProxy::NoProxy));
+}
 
-	m_engine.globalObject().setProperty(QLatin1String("alert"), m_engine.newFunction(alert));
-	m_engine.globalObject().setProperty(QLatin1String("shExpMatch"), m_engine.newFunction(shExpMatch));
-	m_engine.globalObject().setProperty(QLatin1String("dnsDomainIs"), m_engine.newFunction(dnsDomainIs));
-	m_engine.globalObject().setProperty(QLatin1String("isInNet"), m_engine.newFunction(isInNet));
-	m_engine.globalObject().setProperty(QLatin1String("myIpAddress"), m_engine.newFunction(myIpAddress));
-	m_engine.globalObject().setProperty(QLatin1String("dnsResolve"), m_engine.newFunction(dnsResolve));
-	m_engine.globalObject().setProperty(QLatin1String("isPlainHostName"), m_engine.newFunction(isPlainHostName));
-	m_engine.globalObject().setProperty(QLatin1String("isResolvable"), m_engine.newFunction(isResolvable));
-	m_engine.globalObject().setProperty(QLatin1String("localHostOrDomainIs"), m_engine.newFunction(localHostOrDomainIs));
-	m_engine.globalObject().setProperty(QLatin1String("dnsDomainLevels"), m_engine.newFunction(dnsDomainLevels));
-	m_engine.globalObject().setProperty(QLatin1String("weekdayRange"), m_engine.newFunction(weekdayRange));
-	m_engine.globalObject().setProperty(QLatin1String("dateRange"), m_engine.newFunction(dateRange));
-	m_engine.globalObject().setProperty(QLatin1String("timeRange"), m_engine.newFunction(timeRange));
+void NetworkAutomaticProxy::setHosts(const QHash<QString, QList<QHostAddress> > &hosts)
+{
+	m_staticHosts = hosts;
+	m_hasStaticHosts = true;
+
+	m_hosts.clear();
 }
 
 QList<QNetworkProxy> NetworkAutomaticProxy::getProxy(const QString &url, const QString &host)
 {
-	QScriptValueList arguments;
-	arguments << m_engine.toScriptValue(url) << m_engine.toScriptValue(host);
+	const QString key = getConfigurationKey(url, host);
+	QString configuration;
+	bool hasConfiguration = false;
 
-	const QScriptValue result = m_findProxy.call(m_engine.globalObject(), arguments);
+	m_mutex.lock();
 
-	if (result.isError())
+	if (m_configurations.contains(key))
 	{
-		return m_proxies[QLatin1String("ERROR")];
+		configuration = m_configurations[key].first;
+		hasConfiguration = true;
+
+		++m_statistics.configurationHits;
+
+		if (m_configurations[key].second < QDateTime::currentMSecsSinceEpoch() && !m_pendingConfigurations.contains(key))
+		{
+			m_pendingConfigurations.insert(key);
+
+			QMetaObject::invokeMethod(this, "evaluate", Qt::QueuedConnection, Q_ARG(QString, url), Q_ARG(QString, host));
+		}
+	}
+	else
+	{
+		++m_statistics.configurationMisses;
+	}
+
+	m_mutex.unlock();
+
+	if (!hasConfiguration)
+	{
+		if (QThread::currentThread() == thread())
+		{
+			configuration = evaluate(url, host);
+		}
+		else
+		{
+			QMetaObject::invokeMethod(this, "evaluate", Qt::BlockingQueuedConnection, Q_RETURN_ARG(QString, configuration), Q_ARG(QString, url), Q_ARG(QString, host));
+		}
 	}
 
-	const QString configuration = result.toString().remove(QLatin1Char(' '));
+	return getProxies(configuration);
+}
+
+QList<QNetworkProxy> NetworkAutomaticProxy::getProxies(const QString &configuration)
+{
+	m_mutex.lock();
 
 	if (!m_proxies.value(configuration).isEmpty())
 	{
-		return m_proxies[configuration];
+		const QList<QNetworkProxy> proxies = m_proxies[configuration];
+
+		m_mutex.unlock();
+
+		return proxies;
 	}
 
+	m_mutex.unlock();
+
 // proxy format: "PROXY host:port; PROXY host:port", "PROXY host:port; SOCKS host:port" etc.
 // can be combination of DIRECT, PROXY, SOCKS
 	const QStringList proxies = configuration.split(QLatin1Char(';'));
@@ -104,36 +145,87 @@ QList<QNetworkProxy> NetworkAutomaticProxy::getProxy(const QString &url, const Q
 
 		Console::addMessage(QCoreApplication::translate("main", "Failed to parse entry of proxy auto-config (PAC): %1").arg(proxies.at(i)), NetworkMessageCategory, ErrorMessageLevel);
 
+		QMutexLocker locker(&m_mutex);
+
 		return m_proxies[QLatin1String("ERROR")];
 	}
 
+	QMutexLocker locker(&m_mutex);
+
 	m_proxies.insert(configuration, proxiesForQuery);
 
-	return m_proxies[configuration];
+	return proxiesForQuery;
+}
+
+QString NetworkAutomaticProxy::evaluate(const QString &url, const QString &host)
+{
+	QString configuration(QLatin1String("ERROR"));
+
+	if (m_engine && m_findProxy.isFunction())
+	{
+		QScriptValueList arguments;
+		arguments << m_engine->toScriptValue(url) << m_engine->toScriptValue(host);
+
+		const QScriptValue result = m_findProxy.call(m_engine->globalObject(), arguments);
+
+		if (!result.isError())
+		{
+			configuration = result.toString().remove(QLatin1Char(' '));
+		}
+	}
+
+	const QString key = getConfigurationKey(url, host);
+	const qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+	QMutexLocker locker(&m_mutex);
+
+	if (m_configurations.count() >= m_cacheLimit)
+	{
+		QHash<QString, QPair<QString, qint64> >::iterator iterator = m_configurations.begin();
+
+		while (iterator != m_configurations.end())
+		{
+			if (iterator.value().second < currentTime)
+			{
+				iterator = m_configurations.erase(iterator);
+			}
+			else
+			{
+				++iterator;
+			}
+		}
+
+		if (m_configurations.count() >= m_cacheLimit)
+		{
+			m_configurations.clear();
+		}
+	}
+
+	m_configurations[key] = qMakePair(configuration, (currentTime + m_configurationTimeToLive));
+	m_pendingConfigurations.remove(key);
+
+	return configuration;
 }
 
 QScriptValue NetworkAutomaticProxy::alert(QScriptContext *context, QScriptEngine *engine)
 {
-	Q_UNUSED(engine);
+	NetworkAutomaticProxy *proxy = qobject_cast<NetworkAutomaticProxy*>(engine->parent());
 
-	Console::addMessage(context->argument(0).toString(), NetworkMessageCategory, WarningMessageLevel);
+	if (proxy)
+	{
+		emit proxy->alertRequested(context->argument(0).toString());
+	}
 
 	return engine->undefinedValue();
 }
 
 QScriptValue NetworkAutomaticProxy::dnsDomainIs(QScriptContext *context, QScriptEngine *engine)
 {
-	Q_UNUSED(engine);
-
 	if (context->argumentCount() != 2)
 	{
 		return context->throwError(QLatin1String("Function dnsDomainIs takes two arguments!"));
 	}
 
-	const QString address = context->argument(0).toString().toLower();
-	const QString domain = context->argument(1).toString().toLower();
-
-	return engine->toScriptValue(address.contains(domain));
+	return engine->toScriptValue(context->argument(0).toString().contains(context->argument(1).toString(), Qt::CaseInsensitive));
 }
 
 QScriptValue NetworkAutomaticProxy::shExpMatch(QScriptContext *context, QScriptEngine *engine)
@@ -143,7 +235,7 @@ QScriptValue NetworkAutomaticProxy::shExpMatch(QScriptContext *context, QScriptE
 		return context->throwError(QLatin1String("Function shExpMatch takes two arguments!"));
 	}
 
-	return engine->toScriptValue(QRegExp(context->argument(1).toString(), Qt::CaseInsensitive, QRegExp::Wildcard).exactMatch(context->argument(0).toString()));
+	return engine->toScriptValue(getAutomaticProxy(engine)->matchPattern(context->argument(1).toString(), context->argument(0).toString()));
 }
 
 QScriptValue NetworkAutomaticProxy::isInNet(QScriptContext *context, QScriptEngine *engine)
@@ -155,7 +247,23 @@ QScriptValue NetworkAutomaticProxy::isInNet(QScriptContext *context, QScriptEngi
 		return context->throwError(QLatin1String("Function isInNet takes three arguments!"));
 	}
 
-	const QHostAddress address(context->argument(0).toString());
+	QHostAddress address(context->argument(0).toString());
+
+	if (address.isNull())
+	{
+		const QList<QHostAddress> addresses = getAutomaticProxy(engine)->resolveHost(context->argument(0).toString());
+
+		for (int i = 0; i < addresses.count(); ++i)
+		{
+			if (addresses.at(i).protocol() == QAbstractSocket::IPv4Protocol)
+			{
+				address = addresses.at(i);
+
+				break;
+			}
+		}
+	}
+
 	const QHostAddress netaddress(context->argument(1).toString());
 	const QHostAddress netmask(context->argument(2).toString());
 
@@ -191,11 +299,11 @@ QScriptValue NetworkAutomaticProxy::dnsResolve(QScriptContext *context, QScriptE
 		return context->throwError(QLatin1String("Function dnsResolve takes only one argument!"));
 	}
 
-	const QHostInfo host = QHostInfo::fromName(context->argument(0).toString());
+	const QList<QHostAddress> addresses = getAutomaticProxy(engine)->resolveHost(context->argument(0).toString());
 
-	if (host.error() == QHostInfo::NoError && !host.addresses().isEmpty())
+	if (!addresses.isEmpty())
 	{
-		return host.addresses().first().toString();
+		return addresses.first().toString();
 	}
 
 	return engine->undefinedValue();
@@ -215,14 +323,12 @@ QScriptValue NetworkAutomaticProxy::isPlainHostName(QScriptContext *context, QSc
 
 QScriptValue NetworkAutomaticProxy::isResolvable(QScriptContext *context, QScriptEngine *engine)
 {
-	Q_UNUSED(engine);
-
 	if (context->argumentCount() != 1)
 	{
 		return context->throwError(QLatin1String("Function isResolvable takes only one argument!"));
 	}
 
-	return (QHostInfo::fromName(context->argument(0).toString()).error() == QHostInfo::NoError);
+	return !getAutomaticProxy(engine)->resolveHost(context->argument(0).toString()).isEmpty();
 }
 
 QScriptValue NetworkAutomaticProxy::localHostOrDomainIs(QScriptContext *context, QScriptEngine *engine)
@@ -235,15 +341,15 @@ QScriptValue NetworkAutomaticProxy::localHostOrDomainIs(QScriptContext *context,
 	}
 
 // address "google.com" or "maps.google.com" or "www.google.com", domain ".google.com" - return true
-	const QString address = QUrl(context->argument(0).toString()).host().toLower();
-	QString domain = context->argument(1).toString().toLower();
+	const QString address = context->argument(0).toString();
+	const QString domain = context->argument(1).toString();
 
-	if (!address.contains(QLatin1Char('.')) || address.endsWith(domain))
+	if (!address.contains(QLatin1Char('.')) || address.endsWith(domain, Qt::CaseInsensitive))
 	{
 		return true;
 	}
 
-	return (domain.indexOf(QLatin1Char('.')) == 0 && domain.replace(0, 1, QString()) == address);
+	return (domain.startsWith(QLatin1Char('.')) && domain.midRef(1).compare(address, Qt::CaseInsensitive) == 0);
 }
 
 QScriptValue NetworkAutomaticProxy::dnsDomainLevels(QScriptContext *context, QScriptEngine *engine)
@@ -447,18 +553,203 @@ QDateTime NetworkAutomaticProxy::getDateTime(QScriptContext *context, int *numbe
 	return QDateTime::currentDateTime();
 }
 
+NetworkAutomaticProxy* NetworkAutomaticProxy::getAutomaticProxy(QScriptEngine *engine)
+{
+	return qobject_cast<NetworkAutomaticProxy*>(engine->parent());
+}
+
+QList<QHostAddress> NetworkAutomaticProxy::resolveHost(const QString &host)
+{
+	const QString key = host.toLower();
+	qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+
+	if (m_hosts.contains(key) && m_hosts[key].expirationTime > currentTime)
+	{
+		m_mutex.lock();
+		++m_statistics.hostHits;
+		m_mutex.unlock();
+
+		return m_hosts[key].addresses;
+	}
+
+	m_mutex.lock();
+	++m_statistics.hostMisses;
+	m_mutex.unlock();
+
+	HostEntry entry;
+
+	if (m_hasStaticHosts)
+	{
+		entry.addresses = m_staticHosts.value(key);
+	}
+	else
+	{
+		const QHostInfo information = QHostInfo::fromName(host);
+
+		if (information.error() == QHostInfo::NoError)
+		{
+			entry.addresses = information.addresses();
+		}
+
+		currentTime = QDateTime::currentMSecsSinceEpoch();
+	}
+
+	entry.expirationTime = (currentTime + (entry.addresses.isEmpty() ? m_failedHostTimeToLive : m_hostTimeToLive));
+
+	if (m_hosts.count() >= m_cacheLimit)
+	{
+		QHash<QString, HostEntry>::iterator iterator = m_hosts.begin();
+
+		while (iterator != m_hosts.end())
+		{
+			if (iterator.value().expirationTime < currentTime)
+			{
+				iterator = m_hosts.erase(iterator);
+			}
+			else
+			{
+				++iterator;
+			}
+		}
+
+		if (m_hosts.count() >= m_cacheLimit)
+		{
+			m_hosts.clear();
+		}
+	}
+
+	m_hosts[key] = entry;
+
+	return entry.addresses;
+}
+
+QString NetworkAutomaticProxy::getConfigurationKey(const QString &url, const QString &host)
+{
+	return (url.left(url.indexOf(QLatin1Char(':'))).toLower() + QLatin1String("://") + host.toLower());
+}
+
 bool NetworkAutomaticProxy::setup(const QString &script)
 {
-	if (!m_engine.canEvaluate(script) || m_engine.evaluate(script).isError())
+	if (!m_engine)
+	{
+		m_engine = new QScriptEngine(this);
+		m_engine->globalObject().setProperty(QLatin1String("alert"), m_engine->newFunction(alert));
+		m_engine->globalObject().setProperty(QLatin1String("shExpMatch"), m_engine->newFunction(shExpMatch));
+		m_engine->globalObject().setProperty(QLatin1String("dnsDomainIs"), m_engine->newFunction(dnsDomainIs));
+		m_engine->globalObject().setProperty(QLatin1String("isInNet"), m_engine->newFunction(isInNet));
+		m_engine->globalObject().setProperty(QLatin1String("myIpAddress"), m_engine->newFunction(myIpAddress));
+		m_engine->globalObject().setProperty(QLatin1String("dnsResolve"), m_engine->newFunction(dnsResolve));
+		m_engine->globalObject().setProperty(QLatin1String("isPlainHostName"), m_engine->newFunction(isPlainHostName));
+		m_engine->globalObject().setProperty(QLatin1String("isResolvable"), m_engine->newFunction(isResolvable));
+		m_engine->globalObject().setProperty(QLatin1String("localHostOrDomainIs"), m_engine->newFunction(localHostOrDomainIs));
+		m_engine->globalObject().setProperty(QLatin1String("dnsDomainLevels"), m_engine->newFunction(dnsDomainLevels));
+		m_engine->globalObject().setProperty(QLatin1String("weekdayRange"), m_engine->newFunction(weekdayRange));
+		m_engine->globalObject().setProperty(QLatin1String("dateRange"), m_engine->newFunction(dateRange));
+		m_engine->globalObject().setProperty(QLatin1String("timeRange"), m_engine->newFunction(timeRange));
+	}
+
+	m_mutex.lock();
+	m_configurations.clear();
+	m_pendingConfigurations.clear();
+	m_mutex.unlock();
+
+	if (!m_engine->canEvaluate(script) || m_engine->evaluate(script).isError())
 	{
+		m_findProxy = QScriptValue();
+
 		return false;
 	}
 
-	m_findProxy = m_engine.globalObject().property(QLatin1String("FindProxyForURL"));
+	m_findProxy = m_engine->globalObject().property(QLatin1String("FindProxyForURL"));
 
 	return m_findProxy.isFunction();
 }
 
+NetworkAutomaticProxy::Statistics NetworkAutomaticProxy::getStatistics()
+{
+	QMutexLocker locker(&m_mutex);
+
+	return m_statistics;
+}
+
+bool NetworkAutomaticProxy::matchPattern(const QString &pattern, const QString &string)
+{
+	if (m_patterns.contains(pattern))
+	{
+		m_mutex.lock();
+		++m_statistics.patternHits;
+		m_mutex.unlock();
+	}
+	else
+	{
+		m_mutex.lock();
+		++m_statistics.patternMisses;
+		m_mutex.unlock();
+
+		if (m_patterns.count() >= m_cacheLimit)
+		{
+			m_patterns.clear();
+		}
+
+		Pattern compiledPattern;
+		compiledPattern.type = WildcardPattern;
+
+		if (!pattern.contains(QLatin1Char('?')) && !pattern.contains(QLatin1Char('[')) && !pattern.contains(QLatin1Char('\\')))
+		{
+			const bool matchStart = !pattern.startsWith(QLatin1Char('*'));
+			const bool matchEnd = !pattern.endsWith(QLatin1Char('*'));
+			const QString text = pattern.mid((matchStart ? 0 : 1), (pattern.length() - (matchStart ? 0 : 1) - ((matchEnd || pattern.length() < 2) ? 0 : 1)));
+
+			if (!text.contains(QLatin1Char('*')))
+			{
+				compiledPattern.text = text;
+
+				if (matchStart && matchEnd)
+				{
+					compiledPattern.type = ExactPattern;
+				}
+				else if (matchStart)
+				{
+					compiledPattern.type = PrefixPattern;
+				}
+				else if (matchEnd)
+				{
+					compiledPattern.type = SuffixPattern;
+				}
+				else
+				{
+					compiledPattern.type = ContainsPattern;
+				}
+			}
+		}
+
+		if (compiledPattern.type == WildcardPattern)
+		{
+			compiledPattern.expression = QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+		}
+
+		m_patterns[pattern] = compiledPattern;
+	}
+
+	Pattern &compiledPattern = m_patterns[pattern];
+
+	switch (compiledPattern.type)
+	{
+		case ExactPattern:
+			return (string.compare(compiledPattern.text, Qt::CaseInsensitive) == 0);
+		case PrefixPattern:
+			return string.startsWith(compiledPattern.text, Qt::CaseInsensitive);
+		case SuffixPattern:
+			return string.endsWith(compiledPattern.text, Qt::CaseInsensitive);
+		case ContainsPattern:
+			return string.contains(compiledPattern.text, Qt::CaseInsensitive);
+		default:
+			return compiledPattern.expression.exactMatch(string);
+	}
+
+	return false;
+}
+
 bool NetworkAutomaticProxy::compareRange(const QVariant &valueOne, const QVariant &valueTwo, const QVariant &actualValue)
 {
 	return (actualValue >= valueOne && actualValue <= valueTwo);
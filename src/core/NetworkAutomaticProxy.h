@@ -21,6 +21,9 @@
 #ifndef OTTER_NETWORKAUTOMATICPROXY_H
 #define OTTER_NETWORKAUTOMATICPROXY_H
 
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtNetwork/QHostAddress>
 #include <QtNetwork/QNetworkProxy>
 #include <QtScript/QScriptEngine>
 #include <QtScript/QScriptValue>
@@ -28,15 +31,55 @@
 namespace Otter
 {
 
-class NetworkAutomaticProxy
+class NetworkAutomaticProxy : public QObject
 {
+	Q_OBJECT
+
 public:
-	explicit NetworkAutomaticProxy();
+	struct Statistics
+	{
+		int configurationHits;
+		int configurationMisses;
+		int hostHits;
+		int hostMisses;
+		int patternHits;
+		int patternMisses;
+
+		Statistics() : configurationHits(0), configurationMisses(0), hostHits(0), hostMisses(0), patternHits(0), patternMisses(0) {}
+	};
+
+	explicit NetworkAutomaticProxy(QObject *parent = NULL);
 
+	void setHosts(const QHash<QString, QList<QHostAddress> > &hosts);
 	QList<QNetworkProxy> getProxy(const QString &url, const QString &host);
+	Statistics getStatistics();
+
+public slots:
 	bool setup(const QString &script);
 
 protected:
+	enum PatternType
+	{
+		ExactPattern = 0,
+		PrefixPattern,
+		SuffixPattern,
+		ContainsPattern,
+		WildcardPattern
+	};
+
+	struct HostEntry
+	{
+		QList<QHostAddress> addresses;
+		qint64 expirationTime;
+	};
+
+	struct Pattern
+	{
+		QRegExp expression;
+		QString text;
+		PatternType type;
+	};
+
 	static QScriptValue alert(QScriptContext *context, QScriptEngine *engine);
 	static QScriptValue dnsDomainIs(QScriptContext *context, QScriptEngine *engine);
 	static QScriptValue isInNet(QScriptContext *context, QScriptEngine *engine);
@@ -51,15 +94,38 @@ protected:
 	static QScriptValue dateRange(QScriptContext *context, QScriptEngine *engine);
 	static QScriptValue timeRange(QScriptContext *context, QScriptEngine *engine);
 	static QDateTime getDateTime(QScriptContext *context, int *numberOfArguments = NULL);
+	static NetworkAutomaticProxy* getAutomaticProxy(QScriptEngine *engine);
+	QList<QHostAddress> resolveHost(const QString &host);
+	QList<QNetworkProxy> getProxies(const QString &configuration);
+	static QString getConfigurationKey(const QString &url, const QString &host);
 	static bool compareRange(const QVariant &valueOne, const QVariant &valueTwo, const QVariant &actualValue);
+	bool matchPattern(const QString &pattern, const QString &string);
+
+protected slots:
+	QString evaluate(const QString &url, const QString &host);
 
 private:
-	QScriptEngine m_engine;
+	QScriptEngine *m_engine;
 	QScriptValue m_findProxy;
 	QHash<QString, QList<QNetworkProxy> > m_proxies;
+	QHash<QString, QPair<QString, qint64> > m_configurations;
+	QHash<QString, HostEntry> m_hosts;
+	QHash<QString, QList<QHostAddress> > m_staticHosts;
+	QHash<QString, Pattern> m_patterns;
+	QSet<QString> m_pendingConfigurations;
+	QMutex m_mutex;
+	Statistics m_statistics;
+	bool m_hasStaticHosts;
 
 	static QStringList m_months;
 	static QStringList m_days;
+	static const qint64 m_configurationTimeToLive;
+	static const qint64 m_hostTimeToLive;
+	static const qint64 m_failedHostTimeToLive;
+	static const int m_cacheLimit;
+
+signals:
+	void alertRequested(const QString &message);
 };
 
 }
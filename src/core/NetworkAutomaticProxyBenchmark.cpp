@@ -0,0 +1,223 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "NetworkAutomaticProxyBenchmark.h"
+#include "NetworkAutomaticProxy.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QUrl>
+
+namespace Otter
+{
+
+int NetworkAutomaticProxyBenchmark::run(const QStringList &arguments)
+{
+	QCommandLineParser parser;
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption(QLatin1String("proxy-auto-config-benchmark"), QCoreApplication::translate("main", "Replays URLs listed in <path> against proxy auto-config (PAC)"), QLatin1String("path"), QString()));
+	parser.addOption(QCommandLineOption(QLatin1String("proxy-auto-config"), QCoreApplication::translate("main", "Uses proxy auto-config (PAC) script from <path>"), QLatin1String("path"), QString()));
+	parser.addOption(QCommandLineOption(QLatin1String("proxy-auto-config-hosts"), QCoreApplication::translate("main", "Resolves host names using hosts file from <path> instead of DNS"), QLatin1String("path"), QString()));
+	parser.process(arguments);
+
+	QTextStream output(stdout);
+	QTextStream errorOutput(stderr);
+	QFile scriptFile(parser.value(QLatin1String("proxy-auto-config")));
+
+	if (!scriptFile.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		errorOutput << QStringLiteral("Failed to open proxy auto-config (PAC): %1\n").arg(scriptFile.errorString());
+
+		return 1;
+	}
+
+	QHash<QString, QList<QHostAddress> > hosts;
+
+	if (parser.isSet(QLatin1String("proxy-auto-config-hosts")))
+	{
+		QFile hostsFile(parser.value(QLatin1String("proxy-auto-config-hosts")));
+
+		if (!hostsFile.open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			errorOutput << QStringLiteral("Failed to open hosts file: %1\n").arg(hostsFile.errorString());
+
+			return 1;
+		}
+
+		QTextStream stream(&hostsFile);
+
+		while (!stream.atEnd())
+		{
+			const QStringList fields = stream.readLine().section(QLatin1Char('#'), 0, 0).simplified().split(QLatin1Char(' '), QString::SkipEmptyParts);
+			const QHostAddress address(fields.value(0));
+
+			if (address.isNull())
+			{
+				continue;
+			}
+
+			for (int i = 1; i < fields.count(); ++i)
+			{
+				hosts[fields.at(i).toLower()].append(address);
+			}
+		}
+
+		hostsFile.close();
+	}
+
+	NetworkAutomaticProxy proxy;
+	proxy.setHosts(hosts);
+
+	QElapsedTimer timer;
+	timer.start();
+
+	const bool isValid = proxy.setup(scriptFile.readAll());
+
+	scriptFile.close();
+
+	if (!isValid)
+	{
+		errorOutput << QStringLiteral("Failed to load proxy auto-config (PAC): %1\n").arg(scriptFile.fileName());
+
+		return 1;
+	}
+
+	errorOutput << QStringLiteral("Script loaded in %1 ms, %2 hosts in stub resolver\n").arg(timer.elapsed()).arg(hosts.count());
+
+	QFile file(parser.value(QLatin1String("proxy-auto-config-benchmark")));
+
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		errorOutput << QStringLiteral("Failed to open URLs list: %1\n").arg(file.errorString());
+
+		return 1;
+	}
+
+	QTextStream stream(&file);
+	QVector<qint64> latencies;
+	QVector<qint64> evaluationLatencies;
+	qint64 totalTime = 0;
+
+	while (!stream.atEnd())
+	{
+		const QString line = stream.readLine().trimmed();
+
+		if (line.isEmpty() || line.startsWith(QLatin1Char('#')))
+		{
+			continue;
+		}
+
+		const int misses = proxy.getStatistics().configurationMisses;
+
+		timer.start();
+
+		const QList<QNetworkProxy> proxies = proxy.getProxy(line, QUrl(line).host());
+		const qint64 latency = timer.nsecsElapsed();
+
+		latencies.append(latency);
+
+		if (proxy.getStatistics().configurationMisses > misses)
+		{
+			evaluationLatencies.append(latency);
+		}
+
+		totalTime += latency;
+
+		output << line << QLatin1Char('\t') << getProxies(proxies) << QLatin1Char('\n');
+	}
+
+	file.close();
+
+	if (latencies.isEmpty())
+	{
+		errorOutput << QStringLiteral("No URLs found\n");
+
+		return 1;
+	}
+
+	const NetworkAutomaticProxy::Statistics statistics = proxy.getStatistics();
+
+	qSort(latencies);
+	qSort(evaluationLatencies);
+
+	errorOutput << QStringLiteral("URLs: %1, script evaluations: %2\n").arg(latencies.count()).arg(evaluationLatencies.count());
+	errorOutput << QStringLiteral("Total lookup time: %1 ms\n").arg(QString::number(totalTime / 1000000.0, 'f', 3));
+	errorOutput << QStringLiteral("Latency (us): p50 %1, p90 %2, p99 %3, max %4\n").arg(getPercentile(latencies, 50)).arg(getPercentile(latencies, 90)).arg(getPercentile(latencies, 99)).arg(getPercentile(latencies, 100));
+
+	if (!evaluationLatencies.isEmpty())
+	{
+		errorOutput << QStringLiteral("Evaluation latency (us): p50 %1, p90 %2, p99 %3, max %4\n").arg(getPercentile(evaluationLatencies, 50)).arg(getPercentile(evaluationLatencies, 90)).arg(getPercentile(evaluationLatencies, 99)).arg(getPercentile(evaluationLatencies, 100));
+	}
+
+	errorOutput << QStringLiteral("Cache hit rate: results %1, hosts %2, patterns %3\n").arg(getRatio(statistics.configurationHits, statistics.configurationMisses)).arg(getRatio(statistics.hostHits, statistics.hostMisses)).arg(getRatio(statistics.patternHits, statistics.patternMisses));
+
+	return 0;
+}
+
+QString NetworkAutomaticProxyBenchmark::getPercentile(const QVector<qint64> &latencies, int percentile)
+{
+	const int index = qMin((latencies.count() * percentile) / 100, (latencies.count() - 1));
+
+	return QString::number(latencies.at(index) / 1000.0, 'f', 2);
+}
+
+QString NetworkAutomaticProxyBenchmark::getProxies(const QList<QNetworkProxy> &proxies)
+{
+	QStringList entries;
+
+	for (int i = 0; i < proxies.count(); ++i)
+	{
+		switch (proxies.at(i).type())
+		{
+			case QNetworkProxy::NoProxy:
+				entries.append(QLatin1String("DIRECT"));
+
+				break;
+			case QNetworkProxy::HttpProxy:
+				entries.append(QStringLiteral("PROXY %1:%2").arg(proxies.at(i).hostName()).arg(proxies.at(i).port()));
+
+				break;
+			case QNetworkProxy::Socks5Proxy:
+				entries.append(QStringLiteral("SOCKS %1:%2").arg(proxies.at(i).hostName()).arg(proxies.at(i).port()));
+
+				break;
+			default:
+				entries.append(QLatin1String("ERROR"));
+
+				break;
+		}
+	}
+
+	return entries.join(QLatin1String("; "));
+}
+
+QString NetworkAutomaticProxyBenchmark::getRatio(int hits, int misses)
+{
+	if ((hits + misses) == 0)
+	{
+		return QLatin1String("n/a");
+	}
+
+	return QStringLiteral("%1% (%2/%3)").arg(QString::number((hits * 100.0) / (hits + misses), 'f', 1)).arg(hits).arg(hits + misses);
+}
+
+}
@@ -21,13 +21,28 @@
 #include "SessionsManager.h"
 #include "SettingsManager.h"
 
-#include <QtCore/QDateTime>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
 #include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMap>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSet>
+#include <QtCore/QTimerEvent>
 
 namespace Otter
 {
 
-NetworkCache::NetworkCache(QObject *parent) : QNetworkDiskCache(parent)
+const quint32 NetworkCache::m_catalogVersion = 1;
+
+NetworkCache::NetworkCache(QObject *parent) : QNetworkDiskCache(parent),
+	m_size(0),
+	m_saveTimer(0),
+	m_areFileNamesChecked(false),
+	m_areFileNamesValid(true),
+	m_isSaved(false)
 {
 	const QString cachePath = SessionsManager::getCachePath();
 
@@ -36,12 +51,226 @@ NetworkCache::NetworkCache(QObject *parent) : QNetworkDiskCache(parent)
 		QDir().mkpath(cachePath);
 
 		setCacheDirectory(cachePath);
+		locateDataDirectory();
+
+		m_catalogPath = QDir(cacheDirectory()).absoluteFilePath(QLatin1String("catalog.dat"));
+
+		loadCatalog();
+
 		setMaximumCacheSize(SettingsManager::getValue(QLatin1String("Cache/DiskCacheLimit")).toInt() * 1024);
 	}
 
 	connect(SettingsManager::getInstance(), SIGNAL(valueChanged(QString,QVariant)), this, SLOT(optionChanged(QString,QVariant)));
 }
 
+NetworkCache::~NetworkCache()
+{
+	if (m_saveTimer != 0)
+	{
+		killTimer(m_saveTimer);
+	}
+
+	if (!m_isSaved)
+	{
+		save();
+	}
+}
+
+void NetworkCache::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() != m_saveTimer)
+	{
+		return;
+	}
+
+	killTimer(m_saveTimer);
+
+	m_saveTimer = 0;
+
+	save();
+}
+
+void NetworkCache::locateDataDirectory()
+{
+	const QDir cacheMainDirectory(cacheDirectory());
+	const QStringList directories = cacheMainDirectory.entryList(QStringList(QLatin1String("data*")), (QDir::AllDirs | QDir::NoDotAndDotDot));
+	int version = -1;
+
+	for (int i = 0; i < directories.count(); ++i)
+	{
+		if (directories.at(i).mid(4).toInt() > version)
+		{
+			version = directories.at(i).mid(4).toInt();
+
+			m_dataDirectory = cacheMainDirectory.absoluteFilePath(directories.at(i)) + QLatin1Char('/');
+		}
+	}
+
+	if (m_dataDirectory.isEmpty() || m_areFileNamesChecked)
+	{
+		return;
+	}
+
+	QDirIterator iterator(m_dataDirectory, QDir::Files, QDirIterator::Subdirectories);
+
+	while (iterator.hasNext())
+	{
+		const QString path = iterator.next();
+
+		if (path.endsWith(QLatin1String(".d")))
+		{
+			checkCacheFileName(path);
+
+			return;
+		}
+	}
+}
+
+void NetworkCache::checkCacheFileName(const QString &path)
+{
+	const QNetworkCacheMetaData metaData = fileMetaData(path);
+
+	if (!metaData.isValid() || !metaData.url().isValid())
+	{
+		return;
+	}
+
+// file names are computed the way QNetworkDiskCache does internally, confirm that it still matches before relying on it
+	m_areFileNamesValid = (QFileInfo(getCacheFileName(metaData.url())) == QFileInfo(path));
+	m_areFileNamesChecked = true;
+}
+
+void NetworkCache::loadCatalog()
+{
+	QFile file(m_catalogPath);
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		rebuildCatalog();
+
+		return;
+	}
+
+	QDataStream stream(&file);
+	quint32 version;
+	quint32 amount;
+
+	stream >> version >> amount;
+
+	if (version != m_catalogVersion)
+	{
+		file.close();
+
+		rebuildCatalog();
+
+		return;
+	}
+
+	for (quint32 i = 0; i < amount; ++i)
+	{
+		CacheEntry entry;
+
+		stream >> entry.url >> entry.path >> entry.type >> entry.lastModified >> entry.expirationDate >> entry.time >> entry.size;
+
+		if (stream.status() != QDataStream::Ok)
+		{
+			file.close();
+
+			rebuildCatalog();
+
+			return;
+		}
+
+		m_entries[entry.url] = entry;
+		m_size += entry.size;
+	}
+
+	file.close();
+
+	m_isSaved = true;
+}
+
+void NetworkCache::rebuildCatalog()
+{
+	m_entries.clear();
+	m_size = 0;
+
+	if (m_dataDirectory.isEmpty())
+	{
+		return;
+	}
+
+	QDirIterator iterator(m_dataDirectory, QDir::Files, QDirIterator::Subdirectories);
+
+	while (iterator.hasNext())
+	{
+		const QString path = iterator.next();
+
+		if (!path.endsWith(QLatin1String(".d")))
+		{
+			continue;
+		}
+
+		const QNetworkCacheMetaData metaData = fileMetaData(path);
+
+		if (metaData.isValid() && metaData.url().isValid())
+		{
+			addEntry(metaData, iterator.fileInfo().lastModified(), path, iterator.fileInfo().size());
+		}
+	}
+
+	scheduleSave();
+}
+
+void NetworkCache::scheduleSave()
+{
+	if (m_catalogPath.isEmpty())
+	{
+		return;
+	}
+
+	if (m_isSaved)
+	{
+		QFile::remove(m_catalogPath);
+
+		m_isSaved = false;
+	}
+
+	if (m_saveTimer == 0)
+	{
+		m_saveTimer = startTimer(1000);
+	}
+}
+
+void NetworkCache::save()
+{
+	if (m_catalogPath.isEmpty())
+	{
+		return;
+	}
+
+	QSaveFile file(m_catalogPath);
+
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream << m_catalogVersion << quint32(m_entries.count());
+
+	QHash<QUrl, CacheEntry>::const_iterator iterator;
+
+	for (iterator = m_entries.constBegin(); iterator != m_entries.constEnd(); ++iterator)
+	{
+		const CacheEntry &entry = iterator.value();
+
+		stream << entry.url << entry.path << entry.type << entry.lastModified << entry.expirationDate << entry.time << entry.size;
+	}
+
+	m_isSaved = file.commit();
+}
+
 void NetworkCache::clearCache(int period)
 {
 	if (period <= 0)
@@ -53,41 +282,117 @@ void NetworkCache::clearCache(int period)
 		return;
 	}
 
-	const QDir cacheMainDirectory(cacheDirectory());
-	const QStringList directories = cacheMainDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
+	const QDateTime since = QDateTime::currentDateTime().addSecs(-(period * 3600));
+	QList<QUrl> entries;
+	QHash<QUrl, CacheEntry>::const_iterator iterator;
 
-	for (int i = 0; i < directories.count(); ++i)
+	for (iterator = m_entries.constBegin(); iterator != m_entries.constEnd(); ++iterator)
 	{
-		const QDir cacheSubDirectory(cacheMainDirectory.absoluteFilePath(directories.at(i)));
-		const QStringList subDirectories = cacheSubDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
+		if (iterator.value().time >= since)
+		{
+			entries.append(iterator.key());
+		}
+	}
+
+	for (int i = 0; i < entries.count(); ++i)
+	{
+		remove(entries.at(i));
+	}
+}
 
-		for (int j = 0; j < subDirectories.count(); ++j)
+void NetworkCache::clear()
+{
+	m_entries.clear();
+	m_size = 0;
+
+	if (!m_dataDirectory.isEmpty())
+	{
+		QDirIterator iterator(m_dataDirectory, QDir::Files, QDirIterator::Subdirectories);
+
+		while (iterator.hasNext())
 		{
-			const QDir cacheFilesDirectory(cacheSubDirectory.absoluteFilePath(subDirectories.at(j)));
-			const QStringList files = cacheFilesDirectory.entryList(QDir::Files);
+			const QString path = iterator.next();
 
-			for (int k = 0; k < files.count(); ++k)
+			if (path.endsWith(QLatin1String(".d")))
 			{
-				const QNetworkCacheMetaData metaData = fileMetaData(cacheFilesDirectory.absoluteFilePath(files.at(k)));
-
-				if (metaData.isValid() && metaData.lastModified().isValid() && metaData.lastModified().secsTo(QDateTime::currentDateTime()) > (period * 3600))
-				{
-					remove(metaData.url());
-				}
+				QFile::remove(path);
 			}
 		}
 	}
+
+	QNetworkDiskCache::clear();
+
+	scheduleSave();
 }
 
 void NetworkCache::insert(QIODevice *device)
 {
+	const bool isTracked = m_devices.contains(device);
+	const QNetworkCacheMetaData metaData = m_devices.value(device);
+	const qint64 size = (isTracked ? device->size() : 0);
+
 	QNetworkDiskCache::insert(device);
 
-	if (m_devices.contains(device))
+	if (!isTracked)
+	{
+		return;
+	}
+
+	m_devices.remove(device);
+
+	if (!m_areFileNamesChecked)
+	{
+		locateDataDirectory();
+	}
+
+	const QString path = getCacheFileName(metaData.url());
+
+	if (m_areFileNamesValid && !QFile::exists(path))
+	{
+		return;
+	}
+
+	addEntry(metaData, QDateTime::currentDateTime(), path, (path.isEmpty() ? size : QFileInfo(path).size()));
+
+	emit entryAdded(metaData.url());
+}
+
+void NetworkCache::addEntry(const QNetworkCacheMetaData &metaData, const QDateTime &time, const QString &path, qint64 size)
+{
+	const QList<QPair<QByteArray, QByteArray> > headers = metaData.rawHeaders();
+	CacheEntry entry;
+	entry.url = metaData.url();
+	entry.path = path;
+	entry.lastModified = metaData.lastModified();
+	entry.expirationDate = metaData.expirationDate();
+	entry.time = time;
+	entry.size = size;
+
+	for (int i = 0; i < headers.count(); ++i)
 	{
-		emit entryAdded(m_devices[device]);
+		if (headers.at(i).first.toLower() == QByteArray("content-type"))
+		{
+			entry.type = QString(headers.at(i).second).section(QLatin1Char(';'), 0, 0).trimmed();
 
-		m_devices.remove(device);
+			break;
+		}
+	}
+
+	removeEntry(entry.url);
+
+	m_entries[entry.url] = entry;
+	m_size += entry.size;
+
+	scheduleSave();
+}
+
+void NetworkCache::removeEntry(const QUrl &url)
+{
+	if (m_entries.contains(url))
+	{
+		m_size -= m_entries.take(url).size;
+
+		scheduleSave();
 	}
 }
 
@@ -97,84 +402,94 @@ QIODevice* NetworkCache::prepare(const QNetworkCacheMetaData &metaData)
 
 	if (device)
 	{
-		m_devices[device] = metaData.url();
+		m_devices[device] = metaData;
 	}
 
 	return device;
 }
 
-QString NetworkCache::getPathForUrl(const QUrl &url)
+QString NetworkCache::getCacheFileName(const QUrl &url) const
 {
-	if (!url.isValid() || !metaData(url).isValid())
+	if (m_dataDirectory.isEmpty() || !m_areFileNamesValid)
 	{
 		return QString();
 	}
 
-	const QDir cacheMainDirectory(cacheDirectory());
-	const QStringList directories = cacheMainDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
+	QUrl cleanUrl(url);
+	cleanUrl.setPassword(QString());
+	cleanUrl.setFragment(QString());
 
-	for (int i = 0; i < directories.count(); ++i)
-	{
-		const QDir cacheSubDirectory(cacheMainDirectory.absoluteFilePath(directories.at(i)));
-		const QStringList subDirectories = cacheSubDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
+	const QByteArray hash = QCryptographicHash::hash(cleanUrl.toEncoded(), QCryptographicHash::Sha1);
+	const QByteArray identifier = QByteArray::number(*reinterpret_cast<const qlonglong*>(hash.constData()), 36).left(8);
 
-		for (int j = 0; j < subDirectories.count(); ++j)
-		{
-			const QDir cacheFilesDirectory(cacheSubDirectory.absoluteFilePath(subDirectories.at(j)));
-			const QStringList files = cacheFilesDirectory.entryList(QDir::Files);
-
-			for (int k = 0; k < files.count(); ++k)
-			{
-				const QString cacheFilePath = cacheFilesDirectory.absoluteFilePath(files.at(k));
-				const QNetworkCacheMetaData metaData = fileMetaData(cacheFilePath);
+	return m_dataDirectory + QString::number((uint(identifier.at(identifier.length() - 1)) % 16), 16) + QLatin1Char('/') + QLatin1String(identifier) + QLatin1String(".d");
+}
 
-				if (metaData.isValid() && url == metaData.url())
-				{
-					return cacheFilePath;
-				}
-			}
-		}
+QString NetworkCache::getPathForUrl(const QUrl &url)
+{
+	if (!url.isValid() || !m_entries.contains(url))
+	{
+		return QString();
 	}
 
-	return QString();
+	const QString path = m_entries[url].path;
+
+	return ((!path.isEmpty() && QFile::exists(path)) ? path : QString());
+}
+
+NetworkCache::CacheEntry NetworkCache::getEntry(const QUrl &url) const
+{
+	return m_entries.value(url);
 }
 
 QList<QUrl> NetworkCache::getEntries() const
 {
-	QList<QUrl> entries;
+	return m_entries.keys();
+}
 
-	const QDir cacheMainDirectory(cacheDirectory());
-	const QStringList directories = cacheMainDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
+qint64 NetworkCache::expire()
+{
+	if (m_size <= maximumCacheSize())
+	{
+		return m_size;
+	}
 
-	for (int i = 0; i < directories.count(); ++i)
+	QSet<QUrl> insertedEntries;
+	QHash<QIODevice*, QNetworkCacheMetaData>::const_iterator devicesIterator;
+
+	for (devicesIterator = m_devices.constBegin(); devicesIterator != m_devices.constEnd(); ++devicesIterator)
 	{
-		const QDir cacheSubDirectory(cacheMainDirectory.absoluteFilePath(directories.at(i)));
-		const QStringList subDirectories = cacheSubDirectory.entryList(QDir::AllDirs | QDir::NoDotAndDotDot);
+		insertedEntries.insert(devicesIterator.value().url());
+	}
 
-		for (int j = 0; j < subDirectories.count(); ++j)
+	QMultiMap<QDateTime, QUrl> entries;
+	QHash<QUrl, CacheEntry>::const_iterator entriesIterator;
+
+	for (entriesIterator = m_entries.constBegin(); entriesIterator != m_entries.constEnd(); ++entriesIterator)
+	{
+		if (!insertedEntries.contains(entriesIterator.key()))
 		{
-			const QDir cacheFilesDirectory(cacheSubDirectory.absoluteFilePath(subDirectories.at(j)));
-			const QStringList files = cacheFilesDirectory.entryList(QDir::Files);
+			entries.insert(entriesIterator.value().time, entriesIterator.key());
+		}
+	}
 
-			for (int k = 0; k < files.count(); ++k)
-			{
-				const QNetworkCacheMetaData metaData = fileMetaData(cacheFilesDirectory.absoluteFilePath(files.at(k)));
+	const qint64 limit = ((maximumCacheSize() * 9) / 10);
+	QMultiMap<QDateTime, QUrl>::const_iterator iterator;
 
-				if (metaData.url().isValid())
-				{
-					entries.append(metaData.url());
-				}
-			}
-		}
+	for (iterator = entries.constBegin(); (iterator != entries.constEnd() && m_size > limit); ++iterator)
+	{
+		remove(iterator.value());
 	}
 
-	return entries;
+	return m_size;
 }
 
 bool NetworkCache::remove(const QUrl &url)
 {
 	const bool result = QNetworkDiskCache::remove(url);
 
+	removeEntry(url);
+
 	if (result)
 	{
 		emit entryRemoved(url);
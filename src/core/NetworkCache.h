@@ -20,6 +20,7 @@
 #ifndef OTTER_NETWORKCACHE_H
 #define OTTER_NETWORKCACHE_H
 
+#include <QtCore/QDateTime>
 #include <QtNetwork/QNetworkDiskCache>
 
 namespace Otter
@@ -30,20 +31,61 @@ class NetworkCache : public QNetworkDiskCache
 	Q_OBJECT
 
 public:
+	struct CacheEntry
+	{
+		QUrl url;
+		QString path;
+		QString type;
+		QDateTime lastModified;
+		QDateTime expirationDate;
+		QDateTime time;
+		qint64 size;
+
+		CacheEntry() : size(0) {}
+	};
+
 	explicit NetworkCache(QObject *parent = NULL);
+	~NetworkCache();
 
 	void clearCache(int period = 0);
 	void insert(QIODevice *device);
 	QIODevice* prepare(const QNetworkCacheMetaData &metaData);
 	QString getPathForUrl(const QUrl &url);
+	CacheEntry getEntry(const QUrl &url) const;
 	QList<QUrl> getEntries() const;
 	bool remove(const QUrl &url);
 
+public slots:
+	void clear();
+
+protected:
+	void timerEvent(QTimerEvent *event);
+	void locateDataDirectory();
+	void checkCacheFileName(const QString &path);
+	void loadCatalog();
+	void rebuildCatalog();
+	void scheduleSave();
+	void save();
+	void addEntry(const QNetworkCacheMetaData &metaData, const QDateTime &time, const QString &path, qint64 size);
+	void removeEntry(const QUrl &url);
+	QString getCacheFileName(const QUrl &url) const;
+	qint64 expire();
+
 protected slots:
 	void optionChanged(const QString &option, const QVariant &value);
 
 private:
-	QHash<QIODevice*, QUrl> m_devices;
+	QString m_catalogPath;
+	QString m_dataDirectory;
+	QHash<QIODevice*, QNetworkCacheMetaData> m_devices;
+	QHash<QUrl, CacheEntry> m_entries;
+	qint64 m_size;
+	int m_saveTimer;
+	bool m_areFileNamesChecked;
+	bool m_areFileNamesValid;
+	bool m_isSaved;
+
+	static const quint32 m_catalogVersion;
 
 signals:
 	void cleared();
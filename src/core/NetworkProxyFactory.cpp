@@ -29,6 +29,7 @@ namespace Otter
 {
 
 NetworkProxyFactory::NetworkProxyFactory() : QObject(), QNetworkProxyFactory(),
+	m_thread(new QThread(this)),
 	m_automaticProxy(NULL),
 	m_proxyMode(SystemProxy)
 {
@@ -39,6 +40,9 @@ NetworkProxyFactory::NetworkProxyFactory() : QObject(), QNetworkProxyFactory(),
 
 NetworkProxyFactory::~NetworkProxyFactory()
 {
+	m_thread->quit();
+	m_thread->wait();
+
 	if (m_automaticProxy)
 	{
 		delete m_automaticProxy;
@@ -54,12 +58,23 @@ void NetworkProxyFactory::optionChanged(const QString &option)
 		if (!m_automaticProxy)
 		{
 			m_automaticProxy = new NetworkAutomaticProxy();
+			m_automaticProxy->moveToThread(m_thread);
+
+			m_thread->start();
+
+			connect(m_automaticProxy, SIGNAL(alertRequested(QString)), this, SLOT(handleAlertRequested(QString)));
 		}
 
 		const QString path = SettingsManager::getValue(QLatin1String("Proxy/AutomaticConfigurationPath")).toString();
 		QFile file(path);
+		bool isValid = false;
 
-		if (!file.open(QIODevice::ReadOnly | QIODevice::Text) || !m_automaticProxy->setup(file.readAll()))
+		if (file.open(QIODevice::ReadOnly | QIODevice::Text))
+		{
+			QMetaObject::invokeMethod(m_automaticProxy, "setup", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, isValid), Q_ARG(QString, QString(file.readAll())));
+		}
+
+		if (!isValid)
 		{
 			Console::addMessage(tr("Failed to load proxy auto-config (PAC): %1").arg(file.errorString()), NetworkMessageCategory, ErrorMessageLevel, path);
 
@@ -110,6 +125,11 @@ void NetworkProxyFactory::optionChanged(const QString &option)
 	}
 }
 
+void NetworkProxyFactory::handleAlertRequested(const QString &message)
+{
+	Console::addMessage(message, NetworkMessageCategory, WarningMessageLevel);
+}
+
 QList<QNetworkProxy> NetworkProxyFactory::queryProxy(const QNetworkProxyQuery &query)
 {
 	if (m_proxyMode == SystemProxy)
@@ -23,6 +23,7 @@
 
 #include "NetworkAutomaticProxy.h"
 
+#include <QtCore/QThread>
 #include <QtNetwork/QNetworkProxy>
 
 namespace Otter
@@ -49,8 +50,10 @@ public:
 
 protected slots:
 	void optionChanged(const QString &option);
+	void handleAlertRequested(const QString &message);
 
 private:
+	QThread *m_thread;
 	NetworkAutomaticProxy *m_automaticProxy;
 	QHash<QString, QList<QNetworkProxy> > m_proxies;
 	ProxyMode m_proxyMode;
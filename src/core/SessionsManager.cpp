@@ -25,6 +25,7 @@
 #include "WindowsManager.h"
 #include "../ui/MainWindow.h"
 
+#include <QtCore/QDataStream>
 #include <QtCore/QDir>
 #include <QtCore/QSaveFile>
 #include <QtCore/QSettings>
@@ -39,9 +40,14 @@ QString SessionsManager::m_cachePath;
 QString SessionsManager::m_profilePath;
 QList<MainWindow*> SessionsManager::m_windows;
 QList<SessionMainWindow> SessionsManager::m_closedWindows;
+QList<SessionMainWindow> SessionsManager::m_journaledWindows;
+qint64 SessionsManager::m_journalSize = -1;
+qint64 SessionsManager::m_snapshotSize = 0;
 bool SessionsManager::m_isDirty = false;
 bool SessionsManager::m_isPrivate = false;
 
+const quint32 SessionsManager::m_journalMagic = 0x4f534a31;
+
 SessionsManager::SessionsManager(QObject *parent) : QObject(parent),
 	m_saveTimer(0)
 {
@@ -57,7 +63,7 @@ void SessionsManager::timerEvent(QTimerEvent *event)
 
 		m_saveTimer = 0;
 
-		if (!m_isPrivate)
+		if (!m_isPrivate && !saveJournal())
 		{
 			saveSession(QString(), QString(), NULL, false);
 		}
@@ -259,9 +265,147 @@ SessionInformation SessionsManager::getSession(const QString &path)
 		session.windows.append(sessionEntry);
 	}
 
+	replayJournal(session, path);
+
 	return session;
 }
 
+void SessionsManager::replayJournal(SessionInformation &session, const QString &path)
+{
+	QFile file(getJournalPath(path));
+
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return;
+	}
+
+	const QFileInfo snapshotInformation(getSessionPath(path));
+	QDataStream stream(&file);
+	quint32 magic = 0;
+	qint64 snapshotSize = 0;
+	qint64 snapshotModificationTime = 0;
+
+	stream >> magic >> snapshotSize >> snapshotModificationTime;
+
+	if (stream.status() != QDataStream::Ok || magic != m_journalMagic || snapshotSize != snapshotInformation.size() || snapshotModificationTime != snapshotInformation.lastModified().toMSecsSinceEpoch())
+	{
+		file.close();
+
+		return;
+	}
+
+	QList<SessionMainWindow> windows = session.windows;
+
+	while (!stream.atEnd())
+	{
+		quint8 record = 0;
+
+		stream >> record;
+
+		if (record == CommitRecord)
+		{
+			session.windows = windows;
+		}
+		else if (record == SessionRecord)
+		{
+			quint32 amount = 0;
+
+			stream >> amount;
+
+			if (stream.status() != QDataStream::Ok)
+			{
+				break;
+			}
+
+			while (windows.count() > int(amount))
+			{
+				windows.removeLast();
+			}
+
+			while (windows.count() < int(amount))
+			{
+				windows.append(SessionMainWindow());
+			}
+		}
+		else if (record == MainWindowRecord)
+		{
+			quint32 window = 0;
+			quint32 amount = 0;
+			qint32 index = -1;
+			QByteArray geometry;
+
+			stream >> window >> amount >> index >> geometry;
+
+			if (stream.status() != QDataStream::Ok || int(window) >= windows.count())
+			{
+				break;
+			}
+
+			windows[window].geometry = geometry;
+			windows[window].index = index;
+
+			while (windows[window].windows.count() > int(amount))
+			{
+				windows[window].windows.removeLast();
+			}
+
+			while (windows[window].windows.count() < int(amount))
+			{
+				windows[window].windows.append(SessionWindow());
+			}
+		}
+		else if (record == WindowRecord)
+		{
+			quint32 window = 0;
+			quint32 tab = 0;
+			qint32 state = 0;
+			quint32 keptEntries = 0;
+			quint32 addedEntries = 0;
+			SessionWindow sessionWindow;
+
+			stream >> window >> tab >> sessionWindow.searchEngine >> sessionWindow.userAgent >> sessionWindow.geometry >> state >> sessionWindow.group >> sessionWindow.index >> sessionWindow.reloadTime >> sessionWindow.isAlwaysOnTop >> sessionWindow.isPinned >> keptEntries >> addedEntries;
+
+			if (stream.status() != QDataStream::Ok || int(window) >= windows.count() || int(tab) >= windows[window].windows.count())
+			{
+				break;
+			}
+
+			sessionWindow.state = static_cast<WindowState>(state);
+			sessionWindow.history = windows[window].windows[tab].history.mid(0, keptEntries);
+
+			for (quint32 i = 0; i < addedEntries && stream.status() == QDataStream::Ok; ++i)
+			{
+				WindowHistoryEntry historyEntry;
+
+				stream >> historyEntry.url >> historyEntry.title >> historyEntry.position >> historyEntry.zoom;
+
+				sessionWindow.history.append(historyEntry);
+			}
+
+			if (stream.status() != QDataStream::Ok)
+			{
+				break;
+			}
+
+			windows[window].windows[tab] = sessionWindow;
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	file.close();
+}
+
+QString SessionsManager::getJournalPath(const QString &path)
+{
+	QString journalPath = getSessionPath(path);
+	journalPath.chop(4);
+
+	return journalPath + QLatin1String(".journal");
+}
+
 QList<MainWindow*> SessionsManager::getWindows()
 {
 	return m_windows;
@@ -354,6 +498,87 @@ bool SessionsManager::restoreSession(const SessionInformation &session, MainWind
 	return true;
 }
 
+bool SessionsManager::saveJournal()
+{
+	if (m_journalSize < 0 || m_journalSize > qMax(qint64(65536), m_snapshotSize))
+	{
+		return false;
+	}
+
+	const QList<MainWindow*> windows = Application::getInstance()->getWindows();
+	QList<SessionMainWindow> sessions;
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+
+	if (windows.count() != m_journaledWindows.count())
+	{
+		stream << quint8(SessionRecord) << quint32(windows.count());
+	}
+
+	for (int i = 0; i < windows.count(); ++i)
+	{
+		SessionMainWindow sessionEntry = windows.at(i)->getWindowsManager()->getSession();
+		sessionEntry.geometry = windows.at(i)->saveGeometry();
+
+		const SessionMainWindow journaledEntry = m_journaledWindows.value(i, SessionMainWindow());
+
+		if (i >= m_journaledWindows.count() || sessionEntry.index != journaledEntry.index || sessionEntry.geometry != journaledEntry.geometry || sessionEntry.windows.count() != journaledEntry.windows.count())
+		{
+			stream << quint8(MainWindowRecord) << quint32(i) << quint32(sessionEntry.windows.count()) << qint32(sessionEntry.index) << sessionEntry.geometry;
+		}
+
+		for (int j = 0; j < sessionEntry.windows.count(); ++j)
+		{
+			const SessionWindow &sessionWindow = sessionEntry.windows.at(j);
+			const SessionWindow journaledWindow = journaledEntry.windows.value(j, SessionWindow());
+			int keptEntries = 0;
+
+			while (keptEntries < sessionWindow.history.count() && keptEntries < journaledWindow.history.count() && sessionWindow.history.at(keptEntries) == journaledWindow.history.at(keptEntries))
+			{
+				++keptEntries;
+			}
+
+			if (j < journaledEntry.windows.count() && keptEntries == sessionWindow.history.count() && keptEntries == journaledWindow.history.count() && hasSameProperties(sessionWindow, journaledWindow))
+			{
+				continue;
+			}
+
+			stream << quint8(WindowRecord) << quint32(i) << quint32(j) << sessionWindow.searchEngine << sessionWindow.userAgent << sessionWindow.geometry << qint32(sessionWindow.state) << qint32(sessionWindow.group) << qint32(sessionWindow.index) << qint32(sessionWindow.reloadTime) << sessionWindow.isAlwaysOnTop << sessionWindow.isPinned << quint32(keptEntries) << quint32(sessionWindow.history.count() - keptEntries);
+
+			for (int k = keptEntries; k < sessionWindow.history.count(); ++k)
+			{
+				stream << sessionWindow.history.at(k).url << sessionWindow.history.at(k).title << sessionWindow.history.at(k).position << qint32(sessionWindow.history.at(k).zoom);
+			}
+		}
+
+		sessions.append(sessionEntry);
+	}
+
+	m_journaledWindows = sessions;
+
+	if (data.isEmpty())
+	{
+		return true;
+	}
+
+	stream << quint8(CommitRecord);
+
+	QFile file(getJournalPath(QString()));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+	{
+		return false;
+	}
+
+	file.write(data);
+
+	m_journalSize = file.size();
+
+	file.close();
+
+	return true;
+}
+
 bool SessionsManager::saveSession(const QString &path, const QString &title, MainWindow *window, bool clean)
 {
 	if (m_isPrivate && path.isEmpty())
@@ -412,12 +637,15 @@ bool SessionsManager::saveSession(const QString &path, const QString &title, Mai
 	stream << QLatin1String("windows=") << windows.count() << QLatin1Char('\n');
 	stream << QLatin1String("index=1\n\n");
 
+	QList<SessionMainWindow> sessions;
+
 	for (int i = 0; i < windows.count(); ++i)
 	{
-		const SessionMainWindow sessionEntry = windows.at(i)->getWindowsManager()->getSession();
+		SessionMainWindow sessionEntry = windows.at(i)->getWindowsManager()->getSession();
+		sessionEntry.geometry = windows.at(i)->saveGeometry();
 
 		stream << QStringLiteral("[%1/Properties]\n").arg(i + 1);
-		stream << Utils::formatConfigurationEntry(QLatin1String("geometry"), windows.at(i)->saveGeometry().toBase64(), true);
+		stream << Utils::formatConfigurationEntry(QLatin1String("geometry"), sessionEntry.geometry.toBase64(), true);
 		stream << QLatin1String("groups=0\n");
 		stream << QLatin1String("windows=") << sessionEntry.windows.count() << QLatin1Char('\n');
 		stream << QLatin1String("index=") << (sessionEntry.index + 1) << QLatin1String("\n\n");
@@ -472,9 +700,49 @@ bool SessionsManager::saveSession(const QString &path, const QString &title, Mai
 				stream << QLatin1String("zoom=") << sessionEntry.windows.at(j).history.at(k).zoom << QLatin1String("\n\n");
 			}
 		}
+
+		sessions.append(sessionEntry);
+	}
+
+	if (!file.commit())
+	{
+		return false;
+	}
+
+	if (sessionPath == getSessionPath(QString()))
+	{
+		const QString journalPath = getJournalPath(QString());
+
+		QFile::remove(journalPath);
+
+		m_journaledWindows.clear();
+		m_journalSize = -1;
+
+		if (!clean && !window)
+		{
+			const QFileInfo snapshotInformation(sessionPath);
+			QFile journalFile(journalPath);
+
+			if (journalFile.open(QIODevice::WriteOnly))
+			{
+				QDataStream journalStream(&journalFile);
+				journalStream << m_journalMagic << snapshotInformation.size() << snapshotInformation.lastModified().toMSecsSinceEpoch();
+
+				m_journaledWindows = sessions;
+				m_journalSize = journalFile.size();
+				m_snapshotSize = snapshotInformation.size();
+
+				journalFile.close();
+			}
+		}
 	}
 
-	return file.commit();
+	return true;
+}
+
+bool SessionsManager::hasSameProperties(const SessionWindow &first, const SessionWindow &second)
+{
+	return (first.searchEngine == second.searchEngine && first.userAgent == second.userAgent && first.geometry == second.geometry && first.state == second.state && first.group == second.group && first.index == second.index && first.reloadTime == second.reloadTime && first.isAlwaysOnTop == second.isAlwaysOnTop && first.isPinned == second.isPinned);
 }
 
 bool SessionsManager::deleteSession(const QString &path)
@@ -44,6 +44,11 @@ struct WindowHistoryEntry
 	int zoom;
 
 	WindowHistoryEntry() : zoom(SettingsManager::getValue(QLatin1String("Content/DefaultZoom")).toInt()) {}
+
+	bool operator==(const WindowHistoryEntry &other) const
+	{
+		return (url == other.url && title == other.title && position == other.position && zoom == other.zoom);
+	}
 };
 
 struct WindowHistoryInformation
@@ -157,10 +162,22 @@ public:
 	static bool hasUrl(const QUrl &url, bool activate = false);
 
 protected:
+	enum JournalRecord
+	{
+		CommitRecord = 0,
+		SessionRecord = 1,
+		MainWindowRecord = 2,
+		WindowRecord = 3
+	};
+
 	explicit SessionsManager(QObject *parent = NULL);
 
 	void timerEvent(QTimerEvent *event);
 	void scheduleSave();
+	static void replayJournal(SessionInformation &session, const QString &path);
+	static QString getJournalPath(const QString &path);
+	static bool saveJournal();
+	static bool hasSameProperties(const SessionWindow &first, const SessionWindow &second);
 
 private:
 	int m_saveTimer;
@@ -172,9 +189,14 @@ private:
 	static QString m_profilePath;
 	static QList<MainWindow*> m_windows;
 	static QList<SessionMainWindow> m_closedWindows;
+	static QList<SessionMainWindow> m_journaledWindows;
+	static qint64 m_journalSize;
+	static qint64 m_snapshotSize;
 	static bool m_isDirty;
 	static bool m_isPrivate;
 
+	static const quint32 m_journalMagic;
+
 signals:
 	void closedWindowsChanged();
 	void requestedRemoveStoredUrl(QString url);
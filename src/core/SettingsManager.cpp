@@ -22,6 +22,7 @@
 
 #include <QtCore/QFileInfo>
 #include <QtCore/QSettings>
+#include <QtCore/QTimerEvent>
 
 namespace Otter
 {
@@ -30,11 +31,36 @@ SettingsManager* SettingsManager::m_instance = NULL;
 QString SettingsManager::m_globalPath;
 QString SettingsManager::m_overridePath;
 QHash<QString, QVariant> SettingsManager::m_defaults;
+QHash<QString, QVariant> SettingsManager::m_values;
+QHash<QString, QHash<QString, QVariant> > SettingsManager::m_overrides;
+QHash<QString, QVariant> SettingsManager::m_changedValues;
+QHash<QString, QVariant> SettingsManager::m_changedOverrides;
 
-SettingsManager::SettingsManager(QObject *parent) : QObject(parent)
+SettingsManager::SettingsManager(QObject *parent) : QObject(parent),
+	m_saveTimer(0)
 {
 }
 
+SettingsManager::~SettingsManager()
+{
+	if (m_saveTimer != 0)
+	{
+		save();
+	}
+}
+
+void SettingsManager::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() == m_saveTimer)
+	{
+		killTimer(m_saveTimer);
+
+		m_saveTimer = 0;
+
+		save();
+	}
+}
+
 void SettingsManager::createInstance(const QString &path, QObject *parent)
 {
 	if (!m_instance)
@@ -42,46 +68,168 @@ void SettingsManager::createInstance(const QString &path, QObject *parent)
 		m_instance = new SettingsManager(parent);
 		m_globalPath = path + QLatin1String("/otter.conf");
 		m_overridePath = path + QLatin1String("/override.ini");
+
+		const QSettings globalSettings(m_globalPath, QSettings::IniFormat);
+		const QStringList globalKeys = globalSettings.allKeys();
+
+		for (int i = 0; i < globalKeys.count(); ++i)
+		{
+			m_values[globalKeys.at(i)] = globalSettings.value(globalKeys.at(i));
+		}
+
+		const QSettings overrideSettings(m_overridePath, QSettings::IniFormat);
+		const QStringList overrideKeys = overrideSettings.allKeys();
+
+		for (int i = 0; i < overrideKeys.count(); ++i)
+		{
+			const int separator = overrideKeys.at(i).indexOf(QLatin1Char('/'));
+
+			if (separator > 0)
+			{
+				m_overrides[overrideKeys.at(i).left(separator)][overrideKeys.at(i).mid(separator + 1)] = overrideSettings.value(overrideKeys.at(i));
+			}
+		}
 	}
 }
 
 void SettingsManager::registerOption(const QString &key)
 {
-	QSettings(m_globalPath, QSettings::IniFormat).remove(key);
+	const QVariant oldValue = getValue(key);
+
+	m_values.remove(key);
+	m_changedValues[key] = QVariant();
+
+	m_instance->scheduleSave();
 
-	emit m_instance->valueChanged(key, getValue(key));
+	const QVariant value = getValue(key);
+
+	if (value != oldValue)
+	{
+		emit m_instance->valueChanged(key, value);
+	}
 }
 
 void SettingsManager::removeOverride(const QUrl &url, const QString &key)
 {
+	const QString host = getHost(url);
+
 	if (key.isEmpty())
 	{
-		QSettings(m_overridePath, QSettings::IniFormat).remove(url.isLocalFile() ? QLatin1String("localhost") : url.host());
+		const QString prefix = host + QLatin1Char('/');
+		QHash<QString, QVariant>::iterator iterator = m_changedOverrides.begin();
+
+		while (iterator != m_changedOverrides.end())
+		{
+			if (iterator.key().startsWith(prefix))
+			{
+				iterator = m_changedOverrides.erase(iterator);
+			}
+			else
+			{
+				++iterator;
+			}
+		}
+
+		m_overrides.remove(host);
+		m_changedOverrides[host] = QVariant();
 	}
 	else
 	{
-		QSettings(m_overridePath, QSettings::IniFormat).remove((url.isLocalFile() ? QLatin1String("localhost") : url.host()) + QLatin1Char('/') + key);
+		if (m_overrides.contains(host))
+		{
+			m_overrides[host].remove(key);
+
+			if (m_overrides[host].isEmpty())
+			{
+				m_overrides.remove(host);
+			}
+		}
+
+		m_changedOverrides[host + QLatin1Char('/') + key] = QVariant();
+	}
+
+	m_instance->scheduleSave();
+
+	emit m_instance->overrideChanged(host);
+}
+
+void SettingsManager::scheduleSave()
+{
+	if (m_saveTimer == 0)
+	{
+		m_saveTimer = startTimer(500);
+	}
+}
+
+void SettingsManager::save()
+{
+	if (!m_changedValues.isEmpty())
+	{
+		writeChanges(m_globalPath, m_changedValues);
+
+		m_changedValues.clear();
+	}
+
+	if (!m_changedOverrides.isEmpty())
+	{
+		writeChanges(m_overridePath, m_changedOverrides);
+
+		m_changedOverrides.clear();
+	}
+}
+
+void SettingsManager::writeChanges(const QString &path, const QHash<QString, QVariant> &changes)
+{
+	QSettings settings(path, QSettings::IniFormat);
+	QHash<QString, QVariant>::const_iterator iterator;
+
+	for (iterator = changes.constBegin(); iterator != changes.constEnd(); ++iterator)
+	{
+		if (!iterator.value().isValid())
+		{
+			settings.remove(iterator.key());
+		}
+	}
+
+	for (iterator = changes.constBegin(); iterator != changes.constEnd(); ++iterator)
+	{
+		if (iterator.value().isValid())
+		{
+			settings.setValue(iterator.key(), iterator.value());
+		}
 	}
 }
 
 void SettingsManager::setDefaultValue(const QString &key, const QVariant &value)
 {
+	const QVariant oldValue = getValue(key);
+
 	m_defaults[key] = value;
 
-	emit m_instance->valueChanged(key, getValue(key));
+	if (!m_values.contains(key) && value != oldValue)
+	{
+		emit m_instance->valueChanged(key, value);
+	}
 }
 
 void SettingsManager::setValue(const QString &key, const QVariant &value, const QUrl &url)
 {
 	if (!url.isEmpty())
 	{
+		const QString host = getHost(url);
+
 		if (value.isNull())
 		{
-			QSettings(m_overridePath, QSettings::IniFormat).remove((url.isLocalFile() ? QLatin1String("localhost") : url.host()) + QLatin1Char('/') + key);
+			removeOverride(url, key);
 		}
 		else
 		{
-			QSettings(m_overridePath, QSettings::IniFormat).setValue((url.isLocalFile() ? QLatin1String("localhost") : url.host()) + QLatin1Char('/') + key, value);
+			m_overrides[host][key] = value;
+			m_changedOverrides[host + QLatin1Char('/') + key] = value;
+
+			m_instance->scheduleSave();
+
+			emit m_instance->overrideChanged(host);
 		}
 
 		return;
@@ -89,7 +237,10 @@ void SettingsManager::setValue(const QString &key, const QVariant &value, const
 
 	if (getValue(key) != value)
 	{
-		QSettings(m_globalPath, QSettings::IniFormat).setValue(key, value);
+		m_values[key] = value;
+		m_changedValues[key] = value;
+
+		m_instance->scheduleSave();
 
 		emit m_instance->valueChanged(key, value);
 	}
@@ -100,31 +251,53 @@ SettingsManager* SettingsManager::getInstance()
 	return m_instance;
 }
 
+QString SettingsManager::getHost(const QUrl &url)
+{
+	return (url.isLocalFile() ? QLatin1String("localhost") : url.host());
+}
+
 QVariant SettingsManager::getDefaultValue(const QString &key)
 {
-	return m_defaults[key];
+	return m_defaults.value(key);
 }
 
 QVariant SettingsManager::getValue(const QString &key, const QUrl &url)
 {
 	if (!url.isEmpty())
 	{
-		return QSettings(m_overridePath, QSettings::IniFormat).value((url.isLocalFile() ? QLatin1String("localhost") : url.host()) + QLatin1Char('/') + key, getValue(key));
+		const QHash<QString, QHash<QString, QVariant> >::const_iterator overridesIterator = m_overrides.constFind(getHost(url));
+
+		if (overridesIterator != m_overrides.constEnd())
+		{
+			const QHash<QString, QVariant>::const_iterator iterator = overridesIterator.value().constFind(key);
+
+			if (iterator != overridesIterator.value().constEnd())
+			{
+				return iterator.value();
+			}
+		}
+	}
+
+	const QHash<QString, QVariant>::const_iterator iterator = m_values.constFind(key);
+
+	if (iterator != m_values.constEnd())
+	{
+		return iterator.value();
 	}
 
-	return QSettings(m_globalPath, QSettings::IniFormat).value(key, getDefaultValue(key));
+	return m_defaults.value(key);
 }
 
 bool SettingsManager::hasOverride(const QUrl &url, const QString &key)
 {
-	if (key.isEmpty())
-	{
-		return QSettings(m_overridePath, QSettings::IniFormat).childGroups().contains(url.isLocalFile() ? QLatin1String("localhost") : url.host());
-	}
-	else
+	const QHash<QString, QHash<QString, QVariant> >::const_iterator iterator = m_overrides.constFind(getHost(url));
+
+	if (iterator == m_overrides.constEnd())
 	{
-		return QSettings(m_overridePath, QSettings::IniFormat).contains((url.isLocalFile() ? QLatin1String("localhost") : url.host()) + QLatin1Char('/') + key);
+		return false;
 	}
+
+	return (key.isEmpty() || iterator.value().contains(key));
 }
 
 }
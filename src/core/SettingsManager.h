@@ -39,21 +39,35 @@ public:
 	static void setDefaultValue(const QString &key, const QVariant &value);
 	static void setValue(const QString &key, const QVariant &value, const QUrl &url = QUrl());
 	static SettingsManager* getInstance();
+	static QString getHost(const QUrl &url);
 	static QVariant getDefaultValue(const QString &key);
 	static QVariant getValue(const QString &key, const QUrl &url = QUrl());
 	static bool hasOverride(const QUrl &url, const QString &key = QString());
 
 protected:
 	explicit SettingsManager(QObject *parent = NULL);
+	~SettingsManager();
+
+	void timerEvent(QTimerEvent *event);
+	void scheduleSave();
+	static void save();
+	static void writeChanges(const QString &path, const QHash<QString, QVariant> &changes);
 
 private:
+	int m_saveTimer;
+
 	static SettingsManager *m_instance;
 	static QString m_globalPath;
 	static QString m_overridePath;
 	static QHash<QString, QVariant> m_defaults;
+	static QHash<QString, QVariant> m_values;
+	static QHash<QString, QHash<QString, QVariant> > m_overrides;
+	static QHash<QString, QVariant> m_changedValues;
+	static QHash<QString, QVariant> m_changedOverrides;
 
 signals:
 	void valueChanged(QString key, QVariant value);
+	void overrideChanged(QString host);
 };
 
 }
@@ -0,0 +1,169 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#include "WebsiteOptionsManager.h"
+#include "ContentBlockingManager.h"
+#include "SettingsManager.h"
+
+#include <QtCore/QLocale>
+
+namespace Otter
+{
+
+WebsiteOptionsManager* WebsiteOptionsManager::m_instance = NULL;
+QCache<QString, WebsiteOptions> WebsiteOptionsManager::m_cache;
+
+WebsiteOptionsManager::WebsiteOptionsManager(QObject *parent) : QObject(parent)
+{
+	m_cache.setMaxCost(500);
+}
+
+void WebsiteOptionsManager::createInstance(QObject *parent)
+{
+	if (!m_instance)
+	{
+		m_instance = new WebsiteOptionsManager(parent);
+
+		connect(SettingsManager::getInstance(), SIGNAL(valueChanged(QString,QVariant)), m_instance, SLOT(optionChanged()));
+		connect(SettingsManager::getInstance(), SIGNAL(overrideChanged(QString)), m_instance, SLOT(optionChanged()));
+	}
+}
+
+void WebsiteOptionsManager::clearCache()
+{
+	m_cache.clear();
+}
+
+void WebsiteOptionsManager::optionChanged()
+{
+	clearCache();
+}
+
+WebsiteOptionsManager* WebsiteOptionsManager::getInstance()
+{
+	return m_instance;
+}
+
+WebsiteOptions WebsiteOptionsManager::getOptions(const QUrl &url, const QVariantHash &overrides)
+{
+	if (!overrides.isEmpty())
+	{
+		return createOptions(url, overrides);
+	}
+
+	const QString host = SettingsManager::getHost(url);
+	const WebsiteOptions *cachedOptions = m_cache.object(host);
+
+	if (cachedOptions)
+	{
+		return *cachedOptions;
+	}
+
+	const WebsiteOptions options = createOptions(url, overrides);
+
+	m_cache.insert(host, new WebsiteOptions(options));
+
+	return options;
+}
+
+WebsiteOptions WebsiteOptionsManager::createOptions(const QUrl &url, const QVariantHash &overrides)
+{
+	QString acceptLanguage = getValue(QLatin1String("Network/AcceptLanguage"), url, overrides).toString();
+	const QString pluginsPolicy = getValue(QLatin1String("Browser/EnablePlugins"), url, overrides).toString();
+	const QString doNotTrackPolicy = getValue(QLatin1String("Network/DoNotTrackPolicy"), url, overrides).toString();
+	const QString keepMode = getValue(QLatin1String("Network/CookiesKeepMode"), url, overrides).toString();
+	WebsiteOptions options;
+	options.acceptLanguage = (acceptLanguage.isEmpty() ? QLatin1String(" ") : acceptLanguage.replace(QLatin1String("system"), QLocale::system().bcp47Name()));
+	options.defaultCharacterEncoding = getValue(QLatin1String("Content/DefaultCharacterEncoding"), url, overrides).toString();
+	options.userAgent = getValue(QLatin1String("Network/UserAgent"), url, overrides).toString();
+	options.userAgentValue = NetworkManagerFactory::getUserAgent(options.userAgent).value;
+	options.contentBlockingProfiles = ContentBlockingManager::getProfileList(getValue(QLatin1String("Content/BlockingProfiles"), url, overrides).toStringList());
+	options.cookiesPolicy = getCookiesPolicy(getValue(QLatin1String("Network/CookiesPolicy"), url, overrides).toString());
+	options.thirdPartyCookiesPolicy = getCookiesPolicy(getValue(QLatin1String("Network/ThirdPartyCookiesPolicy"), url, overrides).toString());
+	options.cookiesKeepMode = CookieJar::KeepUntilExpiresMode;
+	options.doNotTrackPolicy = NetworkManagerFactory::SkipTrackPolicy;
+	options.canLoadPlugins = (pluginsPolicy == QLatin1String("enabled"));
+	options.canSendReferrer = getValue(QLatin1String("Network/EnableReferrer"), url, overrides).toBool();
+	options.enableImages = getValue(QLatin1String("Browser/EnableImages"), url, overrides).toBool();
+	options.enableJava = getValue(QLatin1String("Browser/EnableJava"), url, overrides).toBool();
+	options.enableJavaScript = getValue(QLatin1String("Browser/EnableJavaScript"), url, overrides).toBool();
+	options.enableLocalStorage = getValue(QLatin1String("Browser/EnableLocalStorage"), url, overrides).toBool();
+	options.enableOfflineStorageDatabase = getValue(QLatin1String("Browser/EnableOfflineStorageDatabase"), url, overrides).toBool();
+	options.enableOfflineWebApplicationCache = getValue(QLatin1String("Browser/EnableOfflineWebApplicationCache"), url, overrides).toBool();
+	options.enablePlugins = (pluginsPolicy != QLatin1String("disabled"));
+	options.javaScriptCanAccessClipboard = getValue(QLatin1String("Browser/JavaScriptCanAccessClipboard"), url, overrides).toBool();
+	options.javaScriptCanChangeWindowGeometry = getValue(QLatin1String("Browser/JavaScriptCanChangeWindowGeometry"), url, overrides).toBool();
+	options.javaScriptCanCloseWindows = getValue(QLatin1String("Browser/JavaScriptCanCloseWindows"), url, overrides).toBool();
+	options.javaScriptCanOpenWindows = getValue(QLatin1String("Browser/JavaScriptCanOpenWindows"), url, overrides).toBool();
+	options.javaScriptCanShowStatusMessages = getValue(QLatin1String("Browser/JavaScriptCanShowStatusMessages"), url, overrides).toBool();
+
+	if (keepMode == QLatin1String("keepUntilExit"))
+	{
+		options.cookiesKeepMode = CookieJar::KeepUntilExitMode;
+	}
+	else if (keepMode == QLatin1String("ask"))
+	{
+		options.cookiesKeepMode = CookieJar::AskIfKeepMode;
+	}
+
+	if (doNotTrackPolicy == QLatin1String("allow"))
+	{
+		options.doNotTrackPolicy = NetworkManagerFactory::AllowToTrackPolicy;
+	}
+	else if (doNotTrackPolicy == QLatin1String("doNotAllow"))
+	{
+		options.doNotTrackPolicy = NetworkManagerFactory::DoNotAllowToTrackPolicy;
+	}
+
+	return options;
+}
+
+QVariant WebsiteOptionsManager::getValue(const QString &key, const QUrl &url, const QVariantHash &overrides)
+{
+	const QVariantHash::const_iterator iterator = overrides.constFind(key);
+
+	if (iterator != overrides.constEnd())
+	{
+		return iterator.value();
+	}
+
+	return SettingsManager::getValue(key, url);
+}
+
+CookieJar::CookiesPolicy WebsiteOptionsManager::getCookiesPolicy(const QString &value)
+{
+	if (value == QLatin1String("ignore"))
+	{
+		return CookieJar::IgnoreCookies;
+	}
+
+	if (value == QLatin1String("readOnly"))
+	{
+		return CookieJar::ReadOnlyCookies;
+	}
+
+	if (value == QLatin1String("acceptExisting"))
+	{
+		return CookieJar::AcceptExistingCookies;
+	}
+
+	return CookieJar::AcceptAllCookies;
+}
+
+}
@@ -0,0 +1,88 @@
+/**************************************************************************
+* Otter Browser: Web browser controlled by the user, not vice-versa.
+* Copyright (C) 2015 Michal Dutkiewicz aka Emdek <michal@emdek.pl>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+**************************************************************************/
+
+#ifndef OTTER_WEBSITEOPTIONSMANAGER_H
+#define OTTER_WEBSITEOPTIONSMANAGER_H
+
+#include "CookieJar.h"
+#include "NetworkManagerFactory.h"
+
+#include <QtCore/QCache>
+#include <QtCore/QObject>
+#include <QtCore/QUrl>
+#include <QtCore/QVariant>
+
+namespace Otter
+{
+
+struct WebsiteOptions
+{
+	QString acceptLanguage;
+	QString defaultCharacterEncoding;
+	QString userAgent;
+	QString userAgentValue;
+	QVector<int> contentBlockingProfiles;
+	CookieJar::CookiesPolicy cookiesPolicy;
+	CookieJar::CookiesPolicy thirdPartyCookiesPolicy;
+	CookieJar::KeepMode cookiesKeepMode;
+	NetworkManagerFactory::DoNotTrackPolicy doNotTrackPolicy;
+	bool canLoadPlugins;
+	bool canSendReferrer;
+	bool enableImages;
+	bool enableJava;
+	bool enableJavaScript;
+	bool enableLocalStorage;
+	bool enableOfflineStorageDatabase;
+	bool enableOfflineWebApplicationCache;
+	bool enablePlugins;
+	bool javaScriptCanAccessClipboard;
+	bool javaScriptCanChangeWindowGeometry;
+	bool javaScriptCanCloseWindows;
+	bool javaScriptCanOpenWindows;
+	bool javaScriptCanShowStatusMessages;
+};
+
+class WebsiteOptionsManager : public QObject
+{
+	Q_OBJECT
+
+public:
+	static void createInstance(QObject *parent = NULL);
+	static void clearCache();
+	static WebsiteOptionsManager* getInstance();
+	static WebsiteOptions getOptions(const QUrl &url, const QVariantHash &overrides = QVariantHash());
+
+protected:
+	explicit WebsiteOptionsManager(QObject *parent = NULL);
+
+	static WebsiteOptions createOptions(const QUrl &url, const QVariantHash &overrides);
+	static QVariant getValue(const QString &key, const QUrl &url, const QVariantHash &overrides);
+	static CookieJar::CookiesPolicy getCookiesPolicy(const QString &value);
+
+protected slots:
+	void optionChanged();
+
+private:
+	static WebsiteOptionsManager *m_instance;
+	static QCache<QString, WebsiteOptions> m_cache;
+};
+
+}
+
+#endif
@@ -18,6 +18,8 @@
 **************************************************************************/
 
 #include "core/Application.h"
+#include "core/ContentBlockingBenchmark.h"
+#include "core/NetworkAutomaticProxyBenchmark.h"
 #include "core/SessionsManager.h"
 #include "core/SettingsManager.h"
 #include "ui/MainWindow.h"
@@ -65,6 +67,23 @@ int main(int argc, char *argv[])
 {
 	qInstallMessageHandler(otterMessageHander);
 
+	for (int i = 1; i < argc; ++i)
+	{
+		if (qstrncmp(argv[i], "--content-blocking-benchmark", 28) == 0)
+		{
+			QCoreApplication application(argc, argv);
+
+			return ContentBlockingBenchmark::run(application.arguments());
+		}
+
+		if (qstrncmp(argv[i], "--proxy-auto-config-benchmark", 29) == 0)
+		{
+			QCoreApplication application(argc, argv);
+
+			return NetworkAutomaticProxyBenchmark::run(application.arguments());
+		}
+	}
+
 	Application application(argc, argv);
 
 	if (application.isRunning())
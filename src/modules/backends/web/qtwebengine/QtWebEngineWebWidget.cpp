@@ -31,6 +31,7 @@
 #include "../../../../core/TransfersManager.h"
 #include "../../../../core/Utils.h"
 #include "../../../../core/WebBackend.h"
+#include "../../../../core/WebsiteOptionsManager.h"
 #include "../../../../ui/AuthenticationDialog.h"
 #include "../../../../ui/ContentsDialog.h"
 #include "../../../../ui/ContentsWidget.h"
@@ -1443,19 +1444,20 @@ void QtWebEngineWebWidget::updateBookmarkActions()
 
 void QtWebEngineWebWidget::updateOptions(const QUrl &url)
 {
+	const WebsiteOptions options = WebsiteOptionsManager::getOptions((url.isEmpty() ? getUrl() : url), getOptions());
 	QWebEngineSettings *settings = m_webView->page()->settings();
-	settings->setAttribute(QWebEngineSettings::AutoLoadImages, getOption(QLatin1String("Browser/EnableImages"), url).toBool());
-	settings->setAttribute(QWebEngineSettings::JavascriptEnabled, getOption(QLatin1String("Browser/EnableJavaScript"), url).toBool());
-	settings->setAttribute(QWebEngineSettings::JavascriptCanAccessClipboard, getOption(QLatin1String("Browser/JavaScriptCanAccessClipboard"), url).toBool());
-	settings->setAttribute(QWebEngineSettings::JavascriptCanOpenWindows, getOption(QLatin1String("Browser/JavaScriptCanOpenWindows"), url).toBool());
-	settings->setAttribute(QWebEngineSettings::LocalStorageEnabled, getOption(QLatin1String("Browser/EnableLocalStorage"), url).toBool());
-	settings->setDefaultTextEncoding(getOption(QLatin1String("Content/DefaultCharacterEncoding"), url).toString());
+	settings->setAttribute(QWebEngineSettings::AutoLoadImages, options.enableImages);
+	settings->setAttribute(QWebEngineSettings::JavascriptEnabled, options.enableJavaScript);
+	settings->setAttribute(QWebEngineSettings::JavascriptCanAccessClipboard, options.javaScriptCanAccessClipboard);
+	settings->setAttribute(QWebEngineSettings::JavascriptCanOpenWindows, options.javaScriptCanOpenWindows);
+	settings->setAttribute(QWebEngineSettings::LocalStorageEnabled, options.enableLocalStorage);
+	settings->setDefaultTextEncoding(options.defaultCharacterEncoding);
 
-	m_webView->page()->profile()->setHttpUserAgent(getBackend()->getUserAgent(NetworkManagerFactory::getUserAgent(getOption(QLatin1String("Network/UserAgent"), url).toString()).value));
+	m_webView->page()->profile()->setHttpUserAgent(getBackend()->getUserAgent(options.userAgentValue));
 
 	disconnect(m_webView->page(), SIGNAL(geometryChangeRequested(QRect)), this, SIGNAL(requestedGeometryChange(QRect)));
 
-	if (getOption(QLatin1String("Browser/JavaScriptCanChangeWindowGeometry"), url).toBool())
+	if (options.javaScriptCanChangeWindowGeometry)
 	{
 		connect(m_webView->page(), SIGNAL(geometryChangeRequested(QRect)), this, SIGNAL(requestedGeometryChange(QRect)));
 	}
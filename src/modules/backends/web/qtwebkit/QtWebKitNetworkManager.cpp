@@ -31,6 +31,7 @@
 #include "../../../../core/SettingsManager.h"
 #include "../../../../core/Utils.h"
 #include "../../../../core/WebBackend.h"
+#include "../../../../core/WebsiteOptionsManager.h"
 #include "../../../../ui/AuthenticationDialog.h"
 #include "../../../../ui/ContentsDialog.h"
 
@@ -315,74 +316,26 @@ void QtWebKitNetworkManager::updateOptions(const QUrl &url)
 		m_backend = AddonsManager::getWebBackend(QLatin1String("qtwebkit"));
 	}
 
-	QString acceptLanguage = SettingsManager::getValue(QLatin1String("Network/AcceptLanguage"), url).toString();
-	acceptLanguage = ((acceptLanguage.isEmpty()) ? QLatin1String(" ") : acceptLanguage.replace(QLatin1String("system"), QLocale::system().bcp47Name()));
+	const WebsiteOptions options = WebsiteOptionsManager::getOptions(url);
 
-	m_acceptLanguage = ((acceptLanguage == NetworkManagerFactory::getAcceptLanguage()) ? QString() : acceptLanguage);
-	m_userAgent = m_backend->getUserAgent(m_widget ? NetworkManagerFactory::getUserAgent(m_widget->getOption(QLatin1String("Network/UserAgent"), url).toString()).value : QString());
+	m_acceptLanguage = ((options.acceptLanguage == NetworkManagerFactory::getAcceptLanguage()) ? QString() : options.acceptLanguage);
+	m_doNotTrackPolicy = options.doNotTrackPolicy;
+	m_canSendReferrer = options.canSendReferrer;
 
-	const QString doNotTrackPolicyValue = SettingsManager::getValue(QLatin1String("Network/DoNotTrackPolicy"), url).toString();
-
-	if (doNotTrackPolicyValue == QLatin1String("allow"))
-	{
-		m_doNotTrackPolicy = NetworkManagerFactory::AllowToTrackPolicy;
-	}
-	else if (doNotTrackPolicyValue == QLatin1String("doNotAllow"))
+// user agent set for this tab takes precedence over resolved per host one
+	if (m_widget)
 	{
-		m_doNotTrackPolicy = NetworkManagerFactory::DoNotAllowToTrackPolicy;
-	}
-	else
-	{
-		m_doNotTrackPolicy = NetworkManagerFactory::SkipTrackPolicy;
-	}
+		const QVariantHash overrides = m_widget->getOptions();
+		const QVariantHash::const_iterator iterator = overrides.constFind(QLatin1String("Network/UserAgent"));
 
-	m_canSendReferrer = SettingsManager::getValue(QLatin1String("Network/EnableReferrer"), url).toBool();
-
-	const QString generalCookiesPolicyValue = SettingsManager::getValue(QLatin1String("Network/CookiesPolicy"), url).toString();
-	CookieJar::CookiesPolicy generalCookiesPolicy = CookieJar::AcceptAllCookies;
-
-	if (generalCookiesPolicyValue == QLatin1String("ignore"))
-	{
-		generalCookiesPolicy = CookieJar::IgnoreCookies;
-	}
-	else if (generalCookiesPolicyValue == QLatin1String("readOnly"))
-	{
-		generalCookiesPolicy = CookieJar::ReadOnlyCookies;
-	}
-	else if (generalCookiesPolicyValue == QLatin1String("acceptExisting"))
-	{
-		generalCookiesPolicy = CookieJar::AcceptExistingCookies;
+		m_userAgent = m_backend->getUserAgent((iterator == overrides.constEnd()) ? options.userAgentValue : NetworkManagerFactory::getUserAgent(iterator.value().toString()).value);
 	}
-
-	const QString thirdPartyCookiesPolicyValue = SettingsManager::getValue(QLatin1String("Network/ThirdPartyCookiesPolicy"), url).toString();
-	CookieJar::CookiesPolicy thirdPartyCookiesPolicy = CookieJar::AcceptAllCookies;
-
-	if (thirdPartyCookiesPolicyValue == QLatin1String("ignore"))
-	{
-		thirdPartyCookiesPolicy = CookieJar::IgnoreCookies;
-	}
-	else if (thirdPartyCookiesPolicyValue == QLatin1String("readOnly"))
-	{
-		thirdPartyCookiesPolicy = CookieJar::ReadOnlyCookies;
-	}
-	else if (thirdPartyCookiesPolicyValue == QLatin1String("acceptExisting"))
-	{
-		thirdPartyCookiesPolicy = CookieJar::AcceptExistingCookies;
-	}
-
-	const QString keepModeValue = SettingsManager::getValue(QLatin1String("Network/CookiesKeepMode"), url).toString();
-	CookieJar::KeepMode keepMode = CookieJar::KeepUntilExpiresMode;
-
-	if (keepModeValue == QLatin1String("keepUntilExit"))
-	{
-		keepMode = CookieJar::KeepUntilExitMode;
-	}
-	else if (keepModeValue == QLatin1String("ask"))
+	else
 	{
-		keepMode = CookieJar::AskIfKeepMode;
+		m_userAgent = m_backend->getUserAgent(QString());
 	}
 
-	m_cookieJarProxy->setup(generalCookiesPolicy, thirdPartyCookiesPolicy, keepMode);
+	m_cookieJarProxy->setup(options.cookiesPolicy, options.thirdPartyCookiesPolicy, options.cookiesKeepMode);
 }
 
 void QtWebKitNetworkManager::setFormRequest(const QUrl &url)
@@ -83,39 +83,39 @@ void QtWebKitPage::pageLoadFinished()
 
 	if (m_widget)
 	{
-		const QStringList domainList = ContentBlockingManager::createSubdomainList(m_widget->getUrl().host());
+		const QVector<int> profiles = m_widget->getContentBlockingProfiles();
+		const QString host = m_widget->getUrl().host();
 
-		for (int i = 0; i < domainList.count(); ++i)
-		{
-			applyContentBlockingRules(ContentBlockingManager::getStyleSheetBlackList(m_widget->getContentBlockingProfiles()).values(domainList.at(i)), true);
-			applyContentBlockingRules(ContentBlockingManager::getStyleSheetWhiteList(m_widget->getContentBlockingProfiles()).values(domainList.at(i)), false);
-		}
+		applyContentBlockingRules(ContentBlockingManager::getStyleSheetBlackList(profiles, host), true);
+		applyContentBlockingRules(ContentBlockingManager::getStyleSheetWhiteList(profiles, host), false);
 	}
 }
 
-void QtWebKitPage::applyContentBlockingRules(const QStringList &rules, bool remove)
+void QtWebKitPage::applyContentBlockingRules(const QString &rules, bool remove)
 {
-	for (int i = 0; i < rules.count(); ++i)
+	if (rules.isEmpty())
+	{
+		return;
+	}
+
+	const QWebElementCollection elements = mainFrame()->documentElement().findAll(rules);
+
+	for (int i = 0; i < elements.count(); ++i)
 	{
-		const QWebElementCollection elements = mainFrame()->documentElement().findAll(rules.at(i));
+		QWebElement element = elements.at(i);
 
-		for (int j = 0; j < elements.count(); ++j)
+		if (element.isNull())
+		{
+			continue;
+		}
+
+		if (remove)
+		{
+			element.removeFromDocument();
+		}
+		else
 		{
-			QWebElement element = elements.at(j);
-
-			if (element.isNull())
-			{
-				continue;
-			}
-
-			if (remove)
-			{
-				element.removeFromDocument();
-			}
-			else
-			{
-				element.setStyleProperty(QLatin1String("display"), QLatin1String("block"));
-			}
+			element.setStyleProperty(QLatin1String("display"), QLatin1String("block"));
 		}
 	}
 }
@@ -52,7 +52,7 @@ public slots:
 protected:
 	QtWebKitPage();
 
-	void applyContentBlockingRules(const QStringList &rules, bool remove);
+	void applyContentBlockingRules(const QString &rules, bool remove);
 	void javaScriptAlert(QWebFrame *frame, const QString &message);
 	void javaScriptConsoleMessage(const QString &note, int line, const QString &source);
 	QWebPage* createWindow(WebWindowType type);
@@ -39,6 +39,7 @@
 #include "../../../../core/SettingsManager.h"
 #include "../../../../core/Transfer.h"
 #include "../../../../core/TransfersManager.h"
+#include "../../../../core/WebsiteOptionsManager.h"
 #include "../../../../core/Utils.h"
 #include "../../../../ui/ContentsDialog.h"
 #include "../../../../ui/ContentsWidget.h"
@@ -126,6 +127,7 @@ QtWebKitWebWidget::QtWebKitWebWidget(bool isPrivate, WebBackend *backend, QtWebK
 	setZoom(SettingsManager::getValue(QLatin1String("Content/DefaultZoom")).toInt());
 
 	connect(BookmarksManager::getModel(), SIGNAL(modelModified()), this, SLOT(updateBookmarkActions()));
+	connect(HistoryManager::getInstance(), SIGNAL(requestFinished(quint64,qint64)), this, SLOT(handleHistoryEntryAdded(quint64,qint64)));
 	connect(SettingsManager::getInstance(), SIGNAL(valueChanged(QString,QVariant)), this, SLOT(optionChanged(QString,QVariant)));
 	connect(m_page, SIGNAL(aboutToNavigate(QWebFrame*,QWebPage::NavigationType)), this, SLOT(navigating(QWebFrame*,QWebPage::NavigationType)));
 	connect(m_page, SIGNAL(requestedNewWindow(WebWidget*,OpenHints)), this, SIGNAL(requestedNewWindow(WebWidget*,OpenHints)));
@@ -488,19 +490,57 @@ void QtWebKitWebWidget::handleHistory()
 
 	if (identifier == 0)
 	{
+		const quint64 request = HistoryManager::requestAddEntry(url, getTitle(), m_webView->icon(), m_isTyped);
 		QVariantList data;
-		data.append(HistoryManager::addEntry(url, getTitle(), m_webView->icon(), m_isTyped));
+		data.append(-1);
 		data.append(getZoom());
 		data.append(QPoint(0, 0));
+		data.append(request);
 
 		m_page->history()->currentItem().setUserData(data);
 
+		m_historyEntryRequests.insert(request);
+
 		SessionsManager::markSessionModified();
 		BookmarksManager::updateVisits(url.toString());
 	}
 	else if (identifier > 0)
 	{
-		HistoryManager::updateEntry(identifier, url, getTitle(), m_webView->icon());
+		HistoryManager::requestUpdateEntry(identifier, url, getTitle(), m_webView->icon());
+	}
+}
+
+void QtWebKitWebWidget::handleHistoryEntryAdded(quint64 request, qint64 entry)
+{
+	if (!m_historyEntryRequests.remove(request))
+	{
+		return;
+	}
+
+	const QList<QWebHistoryItem> items = m_page->history()->items();
+
+	for (int i = 0; i < items.count(); ++i)
+	{
+		QVariantList data = items.at(i).userData().toList();
+
+		if (data.count() <= RequestEntryData || data.at(RequestEntryData).toULongLong() != request)
+		{
+			continue;
+		}
+
+		data[IdentifierEntryData] = entry;
+		data.removeAt(RequestEntryData);
+
+		QWebHistoryItem item(items.at(i));
+		item.setUserData(data);
+
+// title and icon changes were not stored while entry was being added
+		if (i == m_page->history()->currentItemIndex())
+		{
+			handleHistory();
+		}
+
+		break;
 	}
 }
 
@@ -982,28 +1022,29 @@ void QtWebKitWebWidget::updateBookmarkActions()
 
 void QtWebKitWebWidget::updateOptions(const QUrl &url)
 {
+	const WebsiteOptions options = WebsiteOptionsManager::getOptions((url.isEmpty() ? getUrl() : url), getOptions());
 	QWebSettings *settings = m_webView->page()->settings();
-	settings->setAttribute(QWebSettings::AutoLoadImages, getOption(QLatin1String("Browser/EnableImages"), url).toBool());
-	settings->setAttribute(QWebSettings::PluginsEnabled, getOption(QLatin1String("Browser/EnablePlugins"), url).toString() != QLatin1String("disabled"));
-	settings->setAttribute(QWebSettings::JavaEnabled, getOption(QLatin1String("Browser/EnableJava"), url).toBool());
-	settings->setAttribute(QWebSettings::JavascriptEnabled, getOption(QLatin1String("Browser/EnableJavaScript"), url).toBool());
-	settings->setAttribute(QWebSettings::JavascriptCanAccessClipboard, getOption(QLatin1String("Browser/JavaScriptCanAccessClipboard"), url).toBool());
-	settings->setAttribute(QWebSettings::JavascriptCanCloseWindows, getOption(QLatin1String("Browser/JavaScriptCanCloseWindows"), url).toBool());
-	settings->setAttribute(QWebSettings::JavascriptCanOpenWindows, getOption(QLatin1String("Browser/JavaScriptCanOpenWindows"), url).toBool());
-	settings->setAttribute(QWebSettings::LocalStorageEnabled, getOption(QLatin1String("Browser/EnableLocalStorage"), url).toBool());
-	settings->setAttribute(QWebSettings::OfflineStorageDatabaseEnabled, getOption(QLatin1String("Browser/EnableOfflineStorageDatabase"), url).toBool());
-	settings->setAttribute(QWebSettings::OfflineWebApplicationCacheEnabled, getOption(QLatin1String("Browser/EnableOfflineWebApplicationCache"), url).toBool());
-	settings->setDefaultTextEncoding(getOption(QLatin1String("Content/DefaultCharacterEncoding"), url).toString());
+	settings->setAttribute(QWebSettings::AutoLoadImages, options.enableImages);
+	settings->setAttribute(QWebSettings::PluginsEnabled, options.enablePlugins);
+	settings->setAttribute(QWebSettings::JavaEnabled, options.enableJava);
+	settings->setAttribute(QWebSettings::JavascriptEnabled, options.enableJavaScript);
+	settings->setAttribute(QWebSettings::JavascriptCanAccessClipboard, options.javaScriptCanAccessClipboard);
+	settings->setAttribute(QWebSettings::JavascriptCanCloseWindows, options.javaScriptCanCloseWindows);
+	settings->setAttribute(QWebSettings::JavascriptCanOpenWindows, options.javaScriptCanOpenWindows);
+	settings->setAttribute(QWebSettings::LocalStorageEnabled, options.enableLocalStorage);
+	settings->setAttribute(QWebSettings::OfflineStorageDatabaseEnabled, options.enableOfflineStorageDatabase);
+	settings->setAttribute(QWebSettings::OfflineWebApplicationCacheEnabled, options.enableOfflineWebApplicationCache);
+	settings->setDefaultTextEncoding(options.defaultCharacterEncoding);
 
 	disconnect(m_webView->page(), SIGNAL(geometryChangeRequested(QRect)), this, SIGNAL(requestedGeometryChange(QRect)));
 	disconnect(m_webView->page(), SIGNAL(statusBarMessage(QString)), this, SLOT(setStatusMessage(QString)));
 
-	if (getOption(QLatin1String("Browser/JavaScriptCanChangeWindowGeometry"), url).toBool())
+	if (options.javaScriptCanChangeWindowGeometry)
 	{
 		connect(m_webView->page(), SIGNAL(geometryChangeRequested(QRect)), this, SIGNAL(requestedGeometryChange(QRect)));
 	}
 
-	if (getOption(QLatin1String("Browser/JavaScriptCanShowStatusMessages"), url).toBool())
+	if (options.javaScriptCanShowStatusMessages)
 	{
 		connect(m_webView->page(), SIGNAL(statusBarMessage(QString)), this, SLOT(setStatusMessage(QString)));
 	}
@@ -1012,13 +1053,13 @@ void QtWebKitWebWidget::updateOptions(const QUrl &url)
 		setStatusMessage(QString());
 	}
 
-	m_contentBlockingProfiles = ContentBlockingManager::getProfileList(getOption(QLatin1String("Content/BlockingProfiles"), url).toStringList());
+	m_contentBlockingProfiles = options.contentBlockingProfiles;
 
 	m_page->updateStyleSheets(url);
 
 	m_networkManager->updateOptions(url);
 
-	m_canLoadPlugins = (getOption(QLatin1String("Browser/EnablePlugins"), url).toString() == QLatin1String("enabled"));
+	m_canLoadPlugins = options.canLoadPlugins;
 }
 
 void QtWebKitWebWidget::clearOptions()
@@ -22,6 +22,7 @@
 
 #include "../../../../ui/WebWidget.h"
 
+#include <QtCore/QSet>
 #include <QtNetwork/QNetworkReply>
 #include <QtWebKitWidgets/QWebHitTestResult>
 #include <QtWebKitWidgets/QWebInspector>
@@ -88,7 +89,8 @@ protected:
 	{
 		IdentifierEntryData = 0,
 		ZoomEntryData = 1,
-		PositionEntryData = 2
+		PositionEntryData = 2,
+		RequestEntryData = 3
 	};
 
 	explicit QtWebKitWebWidget(bool isPrivate, WebBackend *backend, QtWebKitNetworkManager *networkManager, ContentsWidget *parent = NULL);
@@ -123,6 +125,7 @@ protected slots:
 	void viewSourceReplyFinished(QNetworkReply::NetworkError error = QNetworkReply::NoError);
 	void handlePrintRequest(QWebFrame *frame);
 	void handleWindowCloseRequest();
+	void handleHistoryEntryAdded(quint64 request, qint64 entry);
 	void handlePermissionRequest(QWebFrame *frame, QWebPage::Feature feature);
 	void handlePermissionCancel(QWebFrame *frame, QWebPage::Feature feature);
 	void notifyTitleChanged();
@@ -158,6 +161,7 @@ private:
 	QByteArray m_formRequestBody;
 	QVector<int> m_contentBlockingProfiles;
 	QHash<QNetworkReply*, QPointer<SourceViewerWebWidget> > m_viewSourceReplies;
+	QSet<quint64> m_historyEntryRequests;
 	QHash<int, Action*> m_actions;
 	QNetworkAccessManager::Operation m_formRequestOperation;
 	bool m_canLoadPlugins;
@@ -135,6 +135,7 @@ void CacheContentsWidget::populateCache()
 	connect(cache, SIGNAL(cleared()), this, SLOT(clearEntries()));
 	connect(cache, SIGNAL(entryAdded(QUrl)), this, SLOT(addEntry(QUrl)));
 	connect(cache, SIGNAL(entryRemoved(QUrl)), this, SLOT(removeEntry(QUrl)));
+	connect(HistoryManager::getInstance(), SIGNAL(iconLoaded(QUrl)), this, SLOT(updateIcon(QUrl)));
 	connect(m_model, SIGNAL(modelReset()), this, SLOT(updateActions()));
 	connect(m_ui->cacheView->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)), this, SLOT(updateActions()));
 }
@@ -212,45 +213,31 @@ void CacheContentsWidget::addEntry(const QUrl &entry)
 		}
 	}
 
-	NetworkCache *cache = NetworkManagerFactory::getCache();
-	QIODevice *device = cache->data(entry);
-	const QNetworkCacheMetaData metaData = cache->metaData(entry);
-	const QList<QPair<QByteArray, QByteArray> > headers = metaData.rawHeaders();
-	QString type;
+	const NetworkCache::CacheEntry cacheEntry = NetworkManagerFactory::getCache()->getEntry(entry);
+	QMimeType mimeType = QMimeDatabase().mimeTypeForName(cacheEntry.type);
 
-	for (int i = 0; i < headers.count(); ++i)
+	if (!mimeType.isValid())
 	{
-		if (headers.at(i).first == QStringLiteral("Content-Type").toLatin1())
-		{
-			type = QString(headers.at(i).second);
-
-			break;
-		}
+		mimeType = QMimeDatabase().mimeTypeForUrl(entry);
 	}
 
-	const QMimeType mimeType = ((type.isEmpty() && device) ? QMimeDatabase().mimeTypeForData(device) : QMimeDatabase().mimeTypeForName(type));
 	QList<QStandardItem*> entryItems;
 	entryItems.append(new QStandardItem(entry.path()));
 	entryItems.append(new QStandardItem(mimeType.name()));
-	entryItems.append(new QStandardItem(device ? Utils::formatUnit(device->size()) : QString()));
-	entryItems.append(new QStandardItem(metaData.lastModified().toString()));
-	entryItems.append(new QStandardItem(metaData.expirationDate().toString()));
+	entryItems.append(new QStandardItem(Utils::formatUnit(cacheEntry.size)));
+	entryItems.append(new QStandardItem(cacheEntry.lastModified.toString()));
+	entryItems.append(new QStandardItem(cacheEntry.expirationDate.toString()));
 	entryItems[0]->setData(entry, Qt::UserRole);
-	entryItems[2]->setData((device ? device->size() : 0), Qt::UserRole);
+	entryItems[2]->setData(cacheEntry.size, Qt::UserRole);
 
 	QStandardItem *sizeItem = m_model->item(domainItem->row(), 2);
 
-	if (sizeItem && device)
+	if (sizeItem)
 	{
-		sizeItem->setData((sizeItem->data(Qt::UserRole).toLongLong() + device->size()), Qt::UserRole);
+		sizeItem->setData((sizeItem->data(Qt::UserRole).toLongLong() + cacheEntry.size), Qt::UserRole);
 		sizeItem->setText(Utils::formatUnit(sizeItem->data(Qt::UserRole).toLongLong()));
 	}
 
-	if (device)
-	{
-		device->deleteLater();
-	}
-
 	domainItem->appendRow(entryItems);
 	domainItem->setText(QStringLiteral("%1 (%2)").arg(domain).arg(domainItem->rowCount()));
 
@@ -530,6 +517,16 @@ void CacheContentsWidget::updateActions()
 	}
 }
 
+void CacheContentsWidget::updateIcon(const QUrl &url)
+{
+	QStandardItem *domainItem = ((url.path() == QLatin1String("/")) ? findDomain(url.host()) : NULL);
+
+	if (domainItem)
+	{
+		domainItem->setIcon(HistoryManager::getIcon(url));
+	}
+}
+
 QStandardItem* CacheContentsWidget::findDomain(const QString &domain)
 {
 	for (int i = 0; i < m_model->rowCount(); ++i)
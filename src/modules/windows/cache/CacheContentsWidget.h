@@ -73,6 +73,7 @@ protected slots:
 	void copyEntryLink();
 	void showContextMenu(const QPoint &point);
 	void updateActions();
+	void updateIcon(const QUrl &url);
 
 private:
 	QStandardItemModel *m_model;
@@ -93,6 +93,7 @@ void CookiesContentsWidget::populateCookies()
 
 	connect(cookieJar, SIGNAL(cookieAdded(QNetworkCookie)), this, SLOT(addCookie(QNetworkCookie)));
 	connect(cookieJar, SIGNAL(cookieRemoved(QNetworkCookie)), this, SLOT(removeCookie(QNetworkCookie)));
+	connect(HistoryManager::getInstance(), SIGNAL(iconLoaded(QUrl)), this, SLOT(updateIcon(QUrl)));
 	connect(m_model, SIGNAL(modelReset()), this, SLOT(updateActions()));
 	connect(m_ui->cookiesView->selectionModel(), SIGNAL(selectionChanged(QItemSelection,QItemSelection)), this, SLOT(updateActions()));
 }
@@ -394,6 +395,16 @@ void CookiesContentsWidget::filterCookies(const QString &filter)
 	}
 }
 
+void CookiesContentsWidget::updateIcon(const QUrl &url)
+{
+	QStandardItem *domainItem = ((url.path() == QLatin1String("/")) ? findDomain(url.host()) : NULL);
+
+	if (domainItem)
+	{
+		domainItem->setIcon(HistoryManager::getIcon(url));
+	}
+}
+
 QStandardItem* CookiesContentsWidget::findDomain(const QString &domain)
 {
 	for (int i = 0; i < m_model->rowCount(); ++i)
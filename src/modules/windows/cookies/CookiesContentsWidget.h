@@ -69,6 +69,7 @@ protected slots:
 	void removeAllCookies();
 	void showContextMenu(const QPoint &point);
 	void updateActions();
+	void updateIcon(const QUrl &url);
 
 private:
 	QStandardItemModel *m_model;
@@ -53,6 +53,7 @@ AddressWidget::AddressWidget(Window *window, QWidget *parent) : QComboBox(parent
 	m_loadPluginsLabel(NULL),
 	m_urlIconLabel(NULL),
 	m_removeModelTimer(0),
+	m_canCompleteInline(false),
 	m_isHistoryDropdownEnabled(SettingsManager::getValue(QLatin1String("AddressField/EnableHistoryDropdown")).toBool()),
 	m_isUsingSimpleMode(false),
 	m_wasPopupVisible(false)
@@ -93,6 +94,7 @@ AddressWidget::AddressWidget(Window *window, QWidget *parent) : QComboBox(parent
 
 	connect(this, SIGNAL(activated(QString)), this, SLOT(openUrl(QString)));
 	connect(lineEdit(), SIGNAL(textChanged(QString)), this, SLOT(setCompletion(QString)));
+	connect(AddressCompletionModel::getInstance(), SIGNAL(completionUpdated(QString)), this, SLOT(updateCompletion(QString)));
 	connect(BookmarksManager::getModel(), SIGNAL(modelModified()), this, SLOT(updateBookmark()));
 	connect(HistoryManager::getInstance(), SIGNAL(typedHistoryModelModified()), this, SLOT(updateLineEdit()));
 }
@@ -281,7 +283,7 @@ void AddressWidget::showPopup()
 
 	const QString text = lineEdit()->text();
 
-	if (model())
+	if (model() && model() != HistoryManager::getTypedHistoryModel())
 	{
 		model()->deleteLater();
 	}
@@ -585,8 +587,23 @@ void AddressWidget::updateIcons()
 	lineEdit()->setTextMargins(margins);
 }
 
+void AddressWidget::updateCompletion(const QString &text)
+{
+// history entries arrive after completer already handled typed text, so complete again unless text was changed or deleted meanwhile
+	if (m_canCompleteInline && lineEdit()->hasFocus() && !lineEdit()->hasSelectedText() && lineEdit()->text() == text && lineEdit()->cursorPosition() == text.length())
+	{
+		m_completer->setCompletionPrefix(text);
+		m_completer->complete();
+	}
+}
+
 void AddressWidget::setCompletion(const QString &text)
 {
+	m_canCompleteInline = (text.length() > m_completionText.length() && text.startsWith(m_completionText));
+	m_completionText = text;
+
+	AddressCompletionModel::getInstance()->setFilter(text);
+
 	m_completer->setCompletionPrefix(text);
 }
 
@@ -74,6 +74,7 @@ protected slots:
 	void updateLineEdit();
 	void updateIcons();
 	void setCompletion(const QString &text);
+	void updateCompletion(const QString &text);
 	void setIcon(const QIcon &icon);
 
 private:
@@ -83,11 +84,13 @@ private:
 	QLabel *m_feedsLabel;
 	QLabel *m_loadPluginsLabel;
 	QLabel *m_urlIconLabel;
+	QString m_completionText;
 	QTime m_popupHideTime;
 	QRect m_historyDropdownArrowRectangle;
 	QRect m_securityBadgeRectangle;
 	OpenHints m_hints;
 	int m_removeModelTimer;
+	bool m_canCompleteInline;
 	bool m_isHistoryDropdownEnabled;
 	bool m_isUsingSimpleMode;
 	bool m_wasPopupVisible;